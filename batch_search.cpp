@@ -0,0 +1,237 @@
+#include "batch_search.h"
+
+#include "bit_kernels.h"
+#include "movegen.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+namespace Bot {
+
+namespace {
+
+using LaneMask = WorldBatch::LaneMask;
+using LaneValues = std::array<double, WorldBatch::MAX_WORLDS>;
+
+struct Batch_Move {
+    uint16_t played;    // single rank bit
+    uint16_t additions; // table cards summed to the played rank, 0 for a plain drop or caida
+};
+
+constexpr size_t count_batch_moves() {
+    size_t n { Cuarenta::NUM_RANKS };
+    for (size_t rank_idx{1}; rank_idx <= Cuarenta::NUM_RANKS; rank_idx++) { n += Cuarenta::ADDITIONS_BY_RANK[rank_idx].size(); }
+    return n;
+}
+
+// Every move some hand and table could allow, in generate_all_moves() order.
+constexpr auto make_batch_moves() {
+    std::array<Batch_Move, count_batch_moves()> moves{};
+    size_t n {};
+    for (size_t rank_idx{1}; rank_idx <= Cuarenta::NUM_RANKS; rank_idx++) {
+        const uint16_t played { static_cast<uint16_t>(1u << (rank_idx - 1)) };
+        moves[n++] = Batch_Move{ .played = played, .additions = 0 };
+        for (const Cuarenta::RankMask addition : Cuarenta::ADDITIONS_BY_RANK[rank_idx]) {
+            moves[n++] = Batch_Move{ .played = played, .additions = Cuarenta::to_u16(addition) };
+        }
+    }
+    return moves;
+}
+
+constexpr auto BATCH_MOVES { make_batch_moves() };
+
+// Packed_Hand counts -> RankMask bits, without the per-rank loop branching.
+constexpr uint16_t hand_ranks(const uint32_t counts) {
+    const uint32_t non_zero { (counts | (counts >> 1) | (counts >> 2)) & Cuarenta::Packed_Hand::LOW_BITS };
+    uint32_t mask {};
+    for (uint32_t r{}; r < Cuarenta::NUM_RANKS; r++) {
+        mask |= ((non_zero >> (Cuarenta::Packed_Hand::COUNT_BITS * r)) & 1u) << r;
+    }
+    return static_cast<uint16_t>(mask);
+}
+
+// make_move_unchecked() for every world at once; the move must be legal in
+// each of them.
+void apply_move(WorldBatch& batch, const Batch_Move move) {
+
+    const size_t me { Cuarenta::to_index(batch.to_move) };
+    const uint16_t move_bits { static_cast<uint16_t>(move.played | move.additions) };
+    const uint32_t hand_card { 1u << (Cuarenta::Packed_Hand::COUNT_BITS * static_cast<uint32_t>(std::countr_zero(move.played))) };
+
+    for (size_t w{}; w < batch.size; w++) {
+        const Cuarenta::Move_Effect effect { Cuarenta::move_effect(batch.table[w], batch.last_played[w], move_bits) };
+
+        batch.table[w]        = effect.table_after;
+        batch.last_played[w]  = effect.is_capture ? uint16_t{} : move.played;
+        batch.captured[me][w] = static_cast<uint8_t>(batch.captured[me][w] + effect.num_captured);
+        batch.score[me][w]    = static_cast<uint8_t>(batch.score[me][w] + 2 * effect.is_caida + 2 * effect.is_limpia);
+        batch.hand[me][w]    -= hand_card;
+    }
+}
+
+void evaluate_leaves(const WorldBatch& batch, LaneMask leaves, const Evaluator& evaluator, LaneValues& values) {
+
+    const size_t me  { Cuarenta::to_index(batch.to_move) };
+    const size_t opp { 1 - me };
+
+    if (evaluator.id() == ScoreDifferenceEvaluator::ID) {
+        for (size_t w{}; w < batch.size; w++) {
+            const double value { static_cast<double>(batch.score[me][w] - batch.score[opp][w]
+                + captured_cards_bonus(batch.captured[me][w]) - captured_cards_bonus(batch.captured[opp][w])) };
+            if ((leaves >> w) & 1u) { values[w] = value; }
+        }
+        return;
+    }
+    while (leaves) {
+        const size_t w { static_cast<size_t>(std::countr_zero(leaves)) };
+        leaves &= leaves - 1;
+        values[w] = evaluator.evaluate(batch.get(w));
+    }
+}
+
+// Copies the worlds in lanes to the front of into, recording where each came from.
+void gather(const WorldBatch& from, LaneMask lanes, WorldBatch& into, std::array<uint8_t, WorldBatch::MAX_WORLDS>& origin) {
+    into.size = 0;
+    into.to_move = from.to_move;
+    for (; lanes; lanes &= lanes - 1) {
+        const size_t w { static_cast<size_t>(std::countr_zero(lanes)) };
+        const size_t n { into.size++ };
+        origin[n]           = static_cast<uint8_t>(w);
+        into.table[n]       = from.table[w];
+        into.last_played[n] = from.last_played[w];
+        for (size_t p{}; p < 2; p++) {
+            into.hand[p][n]     = from.hand[p][w];
+            into.captured[p][n] = from.captured[p][w];
+            into.score[p][n]    = from.score[p][w];
+        }
+    }
+}
+
+// Searches every world in the batch. Children are compacted to the worlds a
+// move is legal in, so the kernels never run over worlds that left the line.
+void minimax_lanes(const WorldBatch& batch, const int depth, const Evaluator& evaluator, LaneValues& values) {
+
+    const LaneMask active { batch.all() };
+
+    const size_t me  { Cuarenta::to_index(batch.to_move) };
+    const size_t opp { 1 - me };
+
+    LaneMask lost {};
+    LaneMask out_of_cards {};
+    std::array<uint16_t, WorldBatch::MAX_WORLDS> ranks{};
+    for (size_t w{}; w < batch.size; w++) {
+        lost         |= LaneMask{ batch.score[opp][w] >= 40 } << w;
+        out_of_cards |= LaneMask{ batch.hand[me][w] == 0 } << w;
+        ranks[w] = hand_ranks(batch.hand[me][w]);
+    }
+
+    const LaneMask leaves { active & ~lost & ((depth == 0) ? ~LaneMask{} : out_of_cards) };
+    const LaneMask live   { active & ~lost & ~leaves };
+
+    for (LaneMask m { lost | live }; m; m &= m - 1) {
+        values[static_cast<size_t>(std::countr_zero(m))] = std::numeric_limits<double>::lowest();
+    }
+    evaluate_leaves(batch, leaves, evaluator, values);
+    if (!live) { return; }
+
+    WorldBatch child{};
+    LaneValues child_values{};
+    std::array<uint8_t, WorldBatch::MAX_WORLDS> origin{};
+    for (const Batch_Move move : BATCH_MOVES) {
+        LaneMask legal {};
+        for (size_t w{}; w < batch.size; w++) {
+            const bool has_card   { (ranks[w] & move.played) != 0 };
+            const bool has_target { (batch.table[w] & move.additions) == move.additions };
+            legal |= LaneMask{ has_card && has_target } << w;
+        }
+        legal &= live;
+        if (!legal) { continue; }
+
+        gather(batch, legal, child, origin);
+        apply_move(child, move);
+        child.to_move = (batch.to_move == Cuarenta::Player::P1) ? Cuarenta::Player::P2 : Cuarenta::Player::P1;
+        minimax_lanes(child, depth - 1, evaluator, child_values);
+
+        for (size_t n{}; n < child.size; n++) {
+            values[origin[n]] = std::max(values[origin[n]], -child_values[n]);
+        }
+    }
+}
+
+} // namespace
+
+void WorldBatch::push_back(const Cuarenta::Search_State& state) {
+    if (size == MAX_WORLDS) {
+        throw std::invalid_argument("World batch is full.\n");
+    }
+    if (size != 0 && state.to_move != to_move) {
+        throw std::invalid_argument("Every world in a batch must have the same player to move.\n");
+    }
+    to_move          = state.to_move;
+    table[size]       = Cuarenta::to_u16(state.table.cards);
+    last_played[size] = Cuarenta::to_u16(state.table.last_played_card);
+    for (size_t p{}; p < 2; p++) {
+        hand[p][size]     = state.players[p].hand.counts;
+        captured[p][size] = state.players[p].num_captured_cards;
+        score[p][size]    = state.players[p].score;
+    }
+    size++;
+}
+
+Cuarenta::Search_State WorldBatch::get(const size_t world) const {
+    Cuarenta::Search_State state{};
+    state.to_move = to_move;
+    state.table.cards = Cuarenta::to_mask(table[world]);
+    state.table.last_played_card = Cuarenta::to_rank(last_played[world]);
+    for (size_t p{}; p < 2; p++) {
+        state.players[p].hand.counts         = hand[p][world];
+        state.players[p].num_captured_cards = captured[p][world];
+        state.players[p].score              = score[p][world];
+    }
+    return state;
+}
+
+std::array<double, WorldBatch::MAX_WORLDS> minimax_batch(const WorldBatch& batch, const int depth,
+                                                         const Evaluator& evaluator) {
+    LaneValues values{};
+    if (batch.size != 0) { minimax_lanes(batch, depth, evaluator, values); }
+    return values;
+}
+
+void batch_root_values(const Cuarenta::Search_State& root,
+                       std::span<const Cuarenta::Packed_Hand> opponent_hands,
+                       const util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE>& moves,
+                       const int depth, const Evaluator& evaluator, std::span<double> values) {
+
+    if (values.size() < opponent_hands.size() * moves.size()) {
+        throw std::invalid_argument("Batch root values need a slot per world and move.\n");
+    }
+
+    const size_t opp { 1 - Cuarenta::to_index(root.to_move) };
+    for (size_t first{}; first < opponent_hands.size(); first += WorldBatch::MAX_WORLDS) {
+        const size_t count { std::min(WorldBatch::MAX_WORLDS, opponent_hands.size() - first) };
+
+        WorldBatch batch{};
+        for (size_t w{}; w < count; w++) {
+            Cuarenta::Search_State world { root };
+            world.players[opp].hand = opponent_hands[first + w];
+            batch.push_back(world);
+        }
+
+        // Root moves come from the bot's own hand, so each is legal in every world.
+        for (size_t i{}; i < moves.size(); i++) {
+            const uint16_t played { Cuarenta::to_u16(Cuarenta::Move{ moves.at(i) }.get_played_rank()) };
+            WorldBatch child { batch };
+            apply_move(child, Batch_Move{ .played = played,
+                                          .additions = static_cast<uint16_t>(Cuarenta::to_u16(moves.at(i)) & ~played) });
+            child.to_move = (root.to_move == Cuarenta::Player::P1) ? Cuarenta::Player::P2 : Cuarenta::Player::P1;
+
+            const auto child_values { minimax_batch(child, depth - 1, evaluator) };
+            for (size_t w{}; w < count; w++) { values[(first + w) * moves.size() + i] = -child_values[w]; }
+        }
+    }
+}
+
+} // namespace Bot
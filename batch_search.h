@@ -0,0 +1,58 @@
+#pragma once
+#include "cuarenta.h"
+#include "dynamic_array.h"
+#include "evaluator.h"
+#include "rank.h"
+#include "search_state.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Bot {
+
+// Experimental: plain minimax over up to MAX_WORLDS PIMC worlds at once.
+//
+// Worlds are stored structure-of-arrays and advanced in lockstep. Instead of
+// a move list per world, every node walks the fixed universe of moves any
+// hand could make (one per rank, plus each addition pattern) and builds a
+// bitmask of the worlds in which each one is legal; a move is then applied
+// to every world with one branch-free kernel and searched for the worlds in
+// its mask. Values match minimax() world for world.
+//
+// There is no pruning, transposition table or tablebase probing, and a move
+// legal in few worlds still costs a pass over the whole batch; see the
+// batch/* cases in cuarenta_bench for how it compares with the scalar search.
+struct WorldBatch {
+    static constexpr size_t MAX_WORLDS { 64 };
+    using LaneMask = uint64_t;
+
+    size_t size{};
+    Cuarenta::Player to_move{ Cuarenta::Player::P1 }; // shared: all worlds are at the same ply
+    std::array<uint16_t, MAX_WORLDS> table{};
+    std::array<uint16_t, MAX_WORLDS> last_played{};
+    std::array<std::array<uint32_t, MAX_WORLDS>, 2> hand{};
+    std::array<std::array<uint8_t, MAX_WORLDS>, 2> captured{};
+    std::array<std::array<uint8_t, MAX_WORLDS>, 2> score{};
+
+    // Throws std::invalid_argument when full or when state has another mover.
+    void push_back(const Cuarenta::Search_State& state);
+    Cuarenta::Search_State get(const size_t world) const;
+
+    LaneMask all() const { return (size == MAX_WORLDS) ? ~LaneMask{} : (LaneMask{1} << size) - 1; }
+};
+
+// Minimax value of every world in the batch for the player to move.
+std::array<double, WorldBatch::MAX_WORLDS> minimax_batch(const WorldBatch& batch, const int depth,
+                                                         const Evaluator& evaluator = default_evaluator());
+
+// PIMC root values: root with the opponent's hand replaced by each of
+// opponent_hands, searched to depth after each root move. values is indexed
+// [world * moves.size() + move].
+void batch_root_values(const Cuarenta::Search_State& root,
+                       std::span<const Cuarenta::Packed_Hand> opponent_hands,
+                       const util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE>& moves,
+                       const int depth, const Evaluator& evaluator, std::span<double> values);
+
+} // namespace Bot
@@ -0,0 +1,483 @@
+#include "cuarenta.h"
+#include "game_state.h"
+#include "batch_search.h"
+#include "bot.h"
+#include "evaluator.h"
+#include "movegen.h"
+#include "search_state.h"
+#include "tablebase.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Microbenchmarks in the style of Google Benchmark: each case runs until it
+// has accumulated at least min_time, then reports time per iteration and per
+// search node. Results also go to a CSV file so runs can be diffed.
+
+namespace {
+
+struct Options {
+    double min_time_s { 0.5 };
+    int max_depth { 8 };
+    int num_positions { 16 };
+    int mc_iters { 50 };
+    std::string filter {};
+    std::string output_path { "bench_output.txt" };
+    std::string tablebase_path {};
+    std::string eval_path {};
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations{};
+    double ns_per_iter{};
+    uint64_t nodes_per_iter{}; // 0 when the case has no node count
+};
+
+template <class T>
+inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Runs body (one iteration, returning the nodes it visited) with a doubling
+// iteration count until a batch takes at least min_time.
+Result run_case(const std::string& name, const Options& options, const std::function<uint64_t()>& body) {
+    uint64_t iterations { 1 };
+    while (true) {
+        uint64_t nodes {};
+        const util::Timer timer{};
+        for (uint64_t i{}; i < iterations; i++) {
+            nodes += body();
+        }
+        const double seconds { timer.elapsed_s() };
+
+        if (seconds >= options.min_time_s || iterations >= (uint64_t{1} << 40)) {
+            return Result{ .name = name,
+                           .iterations = iterations,
+                           .ns_per_iter = seconds * 1e9 / static_cast<double>(iterations),
+                           .nodes_per_iter = nodes / iterations };
+        }
+        // Aim a little past min_time so the next batch is usually the last.
+        const double scale { (seconds > 0.0) ? 1.4 * options.min_time_s / seconds : 10.0 };
+        iterations = std::max(iterations + 1,
+                              static_cast<uint64_t>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+    }
+}
+
+// Mid-deal positions reached by random play from seeded deals. Position i
+// has i % 5 moves played, so the corpus covers every hand size.
+std::vector<Cuarenta::Game_State> make_corpus(const int num_positions) {
+    std::vector<Cuarenta::Game_State> corpus;
+    corpus.reserve(static_cast<size_t>(num_positions));
+
+    for (int i{}; i < num_positions; i++) {
+        std::mt19937 gen { static_cast<uint32_t>(1000 + i) };
+        Cuarenta::Game_State game { gen };
+
+        for (int ply{}; ply < i % 5 * 2; ply++) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+            std::uniform_int_distribution<size_t> pick { 0, moves.size() - 1 };
+            Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(pick(gen)) });
+            game.advance_turn();
+        }
+        corpus.push_back(game);
+    }
+    return corpus;
+}
+
+// Same traversal as Bot::minimax, counting the nodes it visits.
+uint64_t count_minimax_nodes(Cuarenta::Search_State& state, const int depth, const Bot::Evaluator& evaluator) {
+    if (Cuarenta::opposing_player_state(state).score >= 40 ||
+        Cuarenta::current_player_state(state).hand.empty() || depth == 0) {
+        return 1;
+    }
+    if (const Bot::Tablebase* tablebase { Bot::active_tablebase() }; tablebase && tablebase->evaluator_id() == evaluator.id() && tablebase->probe(state, depth)) {
+        return 1;
+    }
+    uint64_t nodes { 1 };
+    const auto moves { Cuarenta::generate_all_moves(state) };
+    for (size_t i{}; i < moves.size(); i++) {
+        const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(state, Cuarenta::Move{ moves.at(i) }) };
+        state.advance_turn();
+        nodes += count_minimax_nodes(state, depth - 1, evaluator);
+        state.unadvance_turn();
+        Cuarenta::undo_move_unchecked(state, undo);
+    }
+    return nodes;
+}
+
+std::vector<Result> run_benchmarks(const Options& options) {
+
+    const auto corpus { make_corpus(options.num_positions) };
+    std::vector<Cuarenta::Search_State> packed;
+    for (const auto& game : corpus) { packed.push_back(Cuarenta::to_search_state(game)); }
+
+    std::shared_ptr<const Bot::Evaluator> evaluator{};
+    if (!options.eval_path.empty()) {
+        evaluator = std::make_shared<const Bot::TableEvaluator>(Bot::TableEvaluator::load(options.eval_path));
+    }
+    const Bot::Evaluator& leaf_evaluator { evaluator ? *evaluator : Bot::default_evaluator() };
+
+    std::vector<Result> results;
+    auto add = [&](const std::string& name, const std::function<uint64_t()>& body) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) { return; }
+        results.push_back(run_case(name, options, body));
+        const Result& r { results.back() };
+        std::cout << std::left << std::setw(32) << r.name << std::right
+                  << std::setw(12) << r.iterations
+                  << std::setw(16) << std::fixed << std::setprecision(1) << r.ns_per_iter << " ns";
+        if (r.nodes_per_iter != 0) {
+            const double ns_per_node { r.ns_per_iter / static_cast<double>(r.nodes_per_iter) };
+            std::cout << std::setw(12) << std::setprecision(2) << ns_per_node << " ns/node"
+                      << std::setw(14) << std::setprecision(0) << 1e9 / ns_per_node << " nodes/s";
+        }
+        std::cout << '\n' << std::defaultfloat;
+    };
+
+    add("movegen/search_state", [&] {
+        for (const auto& state : packed) { do_not_optimize(Cuarenta::generate_all_moves(state)); }
+        return uint64_t{ packed.size() };
+    });
+    add("movegen/reference", [&] {
+        for (const auto& state : packed) { do_not_optimize(Cuarenta::generate_all_moves_reference(state)); }
+        return uint64_t{ packed.size() };
+    });
+
+    // Opponent hands as PIMC deals them, from a bot that has seen its own hand.
+    Bot::Bot dealer { 1 };
+    dealer.update_from_hand(Cuarenta::current_player_state(corpus.front()).hand);
+    const Bot::HandSampler sampler { dealer.make_hand_sampler() };
+    std::mt19937 sample_gen { 42 };
+
+    // Node = one card dealt.
+    add("sample_hand/without_replacement", [&] {
+        do_not_optimize(sampler.sample(5, sample_gen));
+        return uint64_t{ 5 };
+    });
+    add("sample_hand/weighted_random_rank", [&] {
+        Cuarenta::Packed_Hand hand{};
+        for (int card{}; card < 5; card++) {
+            const auto rank { dealer.weighted_random_rank(sample_gen) };
+            if (hand.count(rank) < static_cast<int>(Cuarenta::Packed_Hand::MAX_COUNT)) { hand.add(rank); }
+        }
+        do_not_optimize(hand);
+        return uint64_t{ 5 };
+    });
+
+    add("make_undo/search_state", [&] {
+        uint64_t pairs {};
+        for (auto state : packed) {
+            const auto moves { Cuarenta::generate_all_moves(state) };
+            for (size_t i{}; i < moves.size(); i++) {
+                const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(state, Cuarenta::Move{ moves.at(i) }) };
+                do_not_optimize(state);
+                Cuarenta::undo_move_unchecked(state, undo);
+                pairs++;
+            }
+        }
+        return pairs;
+    });
+    // try_make_move() validates first; the gap to search_state is what the
+    // unchecked path saves per node.
+    add("make_undo/search_state_checked", [&] {
+        uint64_t pairs {};
+        for (auto state : packed) {
+            const auto moves { Cuarenta::generate_all_moves(state) };
+            for (size_t i{}; i < moves.size(); i++) {
+                const auto undo { Cuarenta::try_make_move(state, Cuarenta::Move{ moves.at(i) }) };
+                do_not_optimize(state);
+                Cuarenta::undo_move_in_place(state, *undo);
+                pairs++;
+            }
+        }
+        return pairs;
+    });
+    add("make_undo/game_state", [&] {
+        uint64_t pairs {};
+        for (auto game : corpus) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+            for (size_t i{}; i < moves.size(); i++) {
+                const Cuarenta::Undo undo { Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(i) }) };
+                do_not_optimize(game.table);
+                Cuarenta::undo_move_in_place(game, undo);
+                pairs++;
+            }
+        }
+        return pairs;
+    });
+
+    // Node = one leaf evaluation, through the virtual interface as search does.
+    const Bot::TableEvaluator default_tables{};
+    add("evaluate/score_difference", [&packed] {
+        const Bot::Evaluator& score_difference { Bot::default_evaluator() };
+        for (const auto& state : packed) { do_not_optimize(score_difference.evaluate(state)); }
+        return uint64_t{ packed.size() };
+    });
+    add("evaluate/table", [&packed, &default_tables, &evaluator] {
+        const Bot::Evaluator& tables { evaluator ? *evaluator : default_tables };
+        for (const auto& state : packed) { do_not_optimize(tables.evaluate(state)); }
+        return uint64_t{ packed.size() };
+    });
+
+    for (int depth{1}; depth <= options.max_depth; depth++) {
+        uint64_t nodes {};
+        for (auto state : packed) { nodes += count_minimax_nodes(state, depth, leaf_evaluator); }
+
+        add("minimax/depth:" + std::to_string(depth), [&packed, &leaf_evaluator, depth, nodes] {
+            for (auto state : packed) { do_not_optimize(Bot::minimax(state, depth, leaf_evaluator)); }
+            return nodes;
+        });
+        // Same corpus and node count, depth dispatched to a compile-time
+        // specialised search once per root.
+        add("minimax_fixed/depth:" + std::to_string(depth), [&packed, &leaf_evaluator, depth, nodes] {
+            for (auto state : packed) { do_not_optimize(Bot::minimax_fixed_depth(state, depth, leaf_evaluator)); }
+            return nodes;
+        });
+    }
+
+    // Same searches without a transposition table, in generator order and in
+    // MoveOrdering order; node counts show how many cutoffs ordering buys.
+    for (const bool ordered : { false, true }) {
+        for (int depth{2}; depth <= options.max_depth; depth += 2) {
+            auto search_corpus = [&packed, &leaf_evaluator, depth, ordered] {
+                Bot::SearchStats stats{};
+                for (auto state : packed) {
+                    Bot::SearchWorker worker{};
+                    worker.order_moves = ordered;
+                    do_not_optimize(Bot::negamax(state, depth, -std::numeric_limits<double>::max(),
+                                                 std::numeric_limits<double>::max(), nullptr, &worker,
+                                                 leaf_evaluator));
+                    stats.merge(worker.stats);
+                }
+                return stats.nodes;
+            };
+            const uint64_t nodes { search_corpus() };
+            add(std::string{ ordered ? "alphabeta/ordered" : "alphabeta/unordered" } + "/depth:" + std::to_string(depth),
+                [search_corpus, nodes] { search_corpus(); return nodes; });
+        }
+    }
+
+    // Node = one ISMCTS iteration (a deal, a descent, a playout).
+    for (const int iterations : { 1000, 10000 }) {
+        Bot::Bot bot { iterations };
+        bot.seed_ = 1;
+        bot.engine_ = Bot::SearchEngine::Ismcts;
+        bot.evaluator_ = evaluator;
+        std::vector<Bot::Bot> bots;
+        for (const auto& game : corpus) {
+            bots.push_back(bot);
+            bots.back().update_from_hand(Cuarenta::current_player_state(game).hand);
+        }
+        add("ismcts/iterations:" + std::to_string(iterations), [&corpus, bots, iterations, &options] {
+            for (size_t i{}; i < corpus.size(); i++) {
+                do_not_optimize(Bot::choose_best_move(bots[i], corpus[i], options.max_depth));
+            }
+            return static_cast<uint64_t>(iterations) * corpus.size();
+        });
+    }
+
+    for (const int depth : { 2, 4, options.max_depth }) {
+        Bot::Bot bot { options.mc_iters };
+        bot.seed_ = 1;
+        bot.evaluator_ = evaluator;
+        std::vector<Bot::Bot> bots;
+        for (const auto& game : corpus) {
+            bots.push_back(bot);
+            bots.back().update_from_hand(Cuarenta::current_player_state(game).hand);
+        }
+        add("choose_best_move/depth:" + std::to_string(depth), [&corpus, bots, depth] {
+            for (size_t i{}; i < corpus.size(); i++) {
+                do_not_optimize(Bot::choose_best_move(bots[i], corpus[i], depth));
+            }
+            return uint64_t{};
+        });
+    }
+
+    // PIMC root values for 64 sampled worlds per corpus position: one world
+    // at a time with the scalar searches, and all of them in lockstep with
+    // the batched engine. Node = one world, every root move searched.
+    std::vector<std::vector<Cuarenta::Packed_Hand>> world_hands;
+    for (const auto& game : corpus) {
+        Bot::Bot bot { 1 };
+        bot.update_from_hand(Cuarenta::current_player_state(game).hand);
+        const Bot::HandSampler world_sampler { bot.make_hand_sampler() };
+        const int opp_hand_size { static_cast<int>(Cuarenta::opposing_player_state(game).hand.cards.size()) };
+        std::mt19937 world_gen { 7 };
+        auto& hands { world_hands.emplace_back() };
+        for (size_t w{}; w < Bot::WorldBatch::MAX_WORLDS; w++) { hands.push_back(world_sampler.sample(opp_hand_size, world_gen)); }
+    }
+    const uint64_t num_worlds { Bot::WorldBatch::MAX_WORLDS * packed.size() };
+
+    for (int depth{2}; depth <= std::min(options.max_depth, 6); depth += 2) {
+        add("batch/scalar_minimax/depth:" + std::to_string(depth), [&packed, &world_hands, &leaf_evaluator, depth, num_worlds] {
+            for (size_t p{}; p < packed.size(); p++) {
+                const auto moves { Cuarenta::generate_all_moves(packed[p]) };
+                for (const Cuarenta::Packed_Hand hand : world_hands[p]) {
+                    auto world { packed[p] };
+                    Cuarenta::opposing_player_state(world).hand = hand;
+                    for (size_t i{}; i < moves.size(); i++) {
+                        const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(world, Cuarenta::Move{ moves.at(i) }) };
+                        world.advance_turn();
+                        do_not_optimize(Bot::minimax(world, depth - 1, leaf_evaluator));
+                        world.unadvance_turn();
+                        Cuarenta::undo_move_unchecked(world, undo);
+                    }
+                }
+            }
+            return num_worlds;
+        });
+        add("batch/scalar_alphabeta/depth:" + std::to_string(depth), [&packed, &world_hands, &leaf_evaluator, depth, num_worlds] {
+            for (size_t p{}; p < packed.size(); p++) {
+                const auto moves { Cuarenta::generate_all_moves(packed[p]) };
+                for (const Cuarenta::Packed_Hand hand : world_hands[p]) {
+                    auto world { packed[p] };
+                    Cuarenta::opposing_player_state(world).hand = hand;
+                    for (size_t i{}; i < moves.size(); i++) {
+                        const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(world, Cuarenta::Move{ moves.at(i) }) };
+                        world.advance_turn();
+                        do_not_optimize(Bot::negamax(world, depth - 1, -std::numeric_limits<double>::max(),
+                                                     std::numeric_limits<double>::max(), nullptr, nullptr, leaf_evaluator));
+                        world.unadvance_turn();
+                        Cuarenta::undo_move_unchecked(world, undo);
+                    }
+                }
+            }
+            return num_worlds;
+        });
+        add("batch/lockstep/depth:" + std::to_string(depth), [&packed, &world_hands, &leaf_evaluator, depth, num_worlds] {
+            std::vector<double> values;
+            for (size_t p{}; p < packed.size(); p++) {
+                const auto moves { Cuarenta::generate_all_moves(packed[p]) };
+                values.resize(world_hands[p].size() * moves.size());
+                Bot::batch_root_values(packed[p], world_hands[p], moves, depth, leaf_evaluator, values);
+                do_not_optimize(values.data());
+            }
+            return num_worlds;
+        });
+    }
+
+    // Both seats play each corpus deal out, starting every decision cold or
+    // carrying a SearchContext from one decision to the next. The moves are
+    // the same either way. Node = one decision.
+    for (const bool warm : { false, true }) {
+        for (const int depth : { 4, options.max_depth }) {
+            Bot::Bot bot { options.mc_iters };
+            bot.seed_ = 1;
+            bot.evaluator_ = evaluator;
+            add(std::string{ warm ? "deal/warm" : "deal/cold" } + "/depth:" + std::to_string(depth),
+                [&corpus, bot, depth, warm] {
+                    uint64_t decisions {};
+                    for (auto game : corpus) {
+                        std::array<Bot::Bot, 2> bots { bot, bot };
+                        for (size_t p{}; p < bots.size(); p++) {
+                            bots[p].update_from_hand(game.players[p].hand);
+                            if (warm) { bots[p].context_ = std::make_shared<Bot::SearchContext>(); }
+                        }
+                        while (!Cuarenta::current_player_state(game).hand.cards.empty()) {
+                            const auto move { Bot::choose_best_move(bots[Cuarenta::to_index(game.to_move)], game, depth) };
+                            Cuarenta::make_move_in_place(game, move);
+                            game.advance_turn();
+                            decisions++;
+                        }
+                    }
+                    return decisions;
+                });
+        }
+    }
+
+    return results;
+}
+
+void write_results(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out { path };
+    if (!out) { throw std::runtime_error("Could not open " + path + " for writing.\n"); }
+
+    out << "benchmark,iterations,ns_per_iter,nodes_per_iter,ns_per_node,nodes_per_sec\n";
+    for (const Result& r : results) {
+        out << r.name << ',' << r.iterations << ',' << r.ns_per_iter << ',' << r.nodes_per_iter << ',';
+        if (r.nodes_per_iter != 0) {
+            const double ns_per_node { r.ns_per_iter / static_cast<double>(r.nodes_per_iter) };
+            out << ns_per_node << ',' << 1e9 / ns_per_node;
+        } else {
+            out << ',';
+        }
+        out << '\n';
+    }
+}
+
+void print_usage() {
+    std::cout <<
+        "usage: cuarenta_bench [options]\n"
+        "  --filter TEXT      only run benchmarks whose name contains TEXT\n"
+        "  --min-time S       minimum seconds per benchmark (default 0.5)\n"
+        "  --max-depth D      deepest minimax benchmark (default 8)\n"
+        "  --positions N      corpus size (default 16)\n"
+        "  --mc-iters N       Monte-Carlo samples for choose_best_move (default 50)\n"
+        "  --out PATH         CSV results (default bench_output.txt)\n"
+        "  --tablebase PATH   probe this endgame tablebase during search\n"
+        "  --eval PATH        leaf evaluation tables for the search cases\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    Options options{};
+
+    try {
+        for (int i{1}; i < argc; i++) {
+            const std::string_view arg { argv[i] };
+            if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+            if (i + 1 >= argc) { print_usage(); return 1; }
+            const std::string value { argv[++i] };
+
+            if      (arg == "--filter")    { options.filter = value; }
+            else if (arg == "--min-time")  { options.min_time_s = std::stod(value); }
+            else if (arg == "--max-depth") { options.max_depth = std::stoi(value); }
+            else if (arg == "--positions") { options.num_positions = std::stoi(value); }
+            else if (arg == "--mc-iters")  { options.mc_iters = std::stoi(value); }
+            else if (arg == "--out")       { options.output_path = value; }
+            else if (arg == "--tablebase") { options.tablebase_path = value; }
+            else if (arg == "--eval")      { options.eval_path = value; }
+            else {
+                std::cerr << "Unknown option " << arg << '\n';
+                print_usage();
+                return 1;
+            }
+        }
+
+        std::optional<Bot::Tablebase> tablebase{};
+        if (!options.tablebase_path.empty()) {
+            tablebase = Bot::Tablebase::load(options.tablebase_path);
+            Bot::set_active_tablebase(&tablebase.value());
+        }
+
+        const auto results { run_benchmarks(options) };
+        write_results(options.output_path, results);
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
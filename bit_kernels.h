@@ -0,0 +1,98 @@
+#pragma once
+#include "rank.h"
+
+#include <bit>
+#include <cstdint>
+
+namespace Cuarenta {
+
+// The capture rules on raw 16-bit rank masks. Every rank is one bit, Ace in
+// bit 0 up to King in bit 9, so the run of table cards directly above the
+// played card (the waterfall) is a shift and a countr_one, and a move's
+// whole effect on the table comes out without branching on ranks.
+// Shared by make/undo, move ordering and the batched search.
+
+// Highest bit of a move mask: the card played from hand.
+constexpr uint16_t played_bit(const uint16_t move) { return std::bit_floor(move); }
+
+constexpr bool is_addition(const uint16_t move) { return (move & (move - 1)) != 0; }
+
+// Table cards a capture takes besides the waterfall: the summed cards of an
+// addition, or the matching card of a plain capture.
+constexpr uint16_t taken_mask(const uint16_t move) {
+    return is_addition(move) ? static_cast<uint16_t>(move & ~played_bit(move)) : move;
+}
+
+// Cards won by a capture besides the waterfall, played card included. An
+// addition sums two or three table cards, so clearing the lowest bit twice
+// tells them apart without a popcount (a library call on baseline x86-64).
+constexpr int capture_count(const uint16_t move) {
+    const uint32_t rest { static_cast<uint32_t>(move & (move - 1)) }; // without the lowest card
+    if (rest == 0) { return 2; }                                      // plain capture: played + matched
+    const uint32_t top { rest & (rest - 1) };                         // without the two lowest
+    return 3 + static_cast<int>((top & (top - 1)) != 0);
+}
+
+// Number of consecutive table ranks directly above played.
+constexpr int waterfall_length(const uint16_t table, const uint16_t played) {
+    return std::countr_one(static_cast<uint32_t>(table) >> (std::countr_zero(played) + 1));
+}
+
+// The length ranks directly above played.
+constexpr uint16_t waterfall_mask(const uint16_t played, const int length) {
+    return static_cast<uint16_t>(((1u << length) - 1u) << (std::countr_zero(played) + 1));
+}
+
+struct Move_Effect {
+    uint16_t table_after;
+    int num_captured;    // cards won, played card included; 0 for a drop
+    int num_waterfalled;
+    bool is_capture;
+    bool is_caida;       // +2: plain capture of the card the opponent just dropped
+    bool is_limpia;      // +2: table left empty
+};
+
+// What move does to table, given the card last dropped on it. The played
+// card must be in hand and an addition's cards on the table; try_make_move
+// checks both.
+constexpr Move_Effect move_effect(const uint16_t table, const uint16_t last_played, const uint16_t move) {
+    const uint16_t played { played_bit(move) };
+    const uint16_t taken  { taken_mask(move) };
+    const bool addition   { is_addition(move) };
+    const bool capture    { (table & taken) == taken };
+
+    const int run { capture ? waterfall_length(table, played) : 0 };
+    const uint16_t after { capture ? static_cast<uint16_t>(table & ~(waterfall_mask(played, run) | taken))
+                                   : static_cast<uint16_t>(table | played) };
+    return Move_Effect{
+        .table_after     = after,
+        .num_captured    = capture ? capture_count(move) + run : 0,
+        .num_waterfalled = run,
+        .is_capture      = capture,
+        .is_caida        = capture && !addition && played == last_played,
+        .is_limpia       = after == 0,
+    };
+}
+
+// Inverse of move_effect(), from the table it left behind, the waterfall
+// length and the card last dropped before the move. A plain move leaves the
+// played card on the table exactly when it was a drop.
+constexpr Move_Effect undo_effect(const uint16_t table_after, const uint16_t last_played_before,
+                                  const uint16_t move, const int num_waterfalled) {
+    const uint16_t played { played_bit(move) };
+    const bool addition   { is_addition(move) };
+    const bool capture    { addition || (table_after & played) == 0 };
+
+    const uint16_t before { capture ? static_cast<uint16_t>(table_after | taken_mask(move) | waterfall_mask(played, num_waterfalled))
+                                    : static_cast<uint16_t>(table_after & ~played) };
+    return Move_Effect{
+        .table_after     = before, // the table to restore
+        .num_captured    = capture ? capture_count(move) + num_waterfalled : 0,
+        .num_waterfalled = num_waterfalled,
+        .is_capture      = capture,
+        .is_caida        = capture && !addition && played == last_played_before,
+        .is_limpia       = table_after == 0,
+    };
+}
+
+} // namespace Cuarenta
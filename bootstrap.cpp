@@ -0,0 +1,274 @@
+#include "bootstrap.h"
+
+#include "bot.h"
+#include "cuarenta.h"
+#include "game_state.h"
+#include "thread_pool.h"
+#include "timer.h"
+#include "transposition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace selfplay {
+
+namespace {
+
+constexpr int BACKFIT_ITERATIONS { 50 };
+
+int32_t to_fixed_point(const double points) {
+    return static_cast<int32_t>(std::lround(points * Bot::TableEvaluator::FIXED_POINT_ONE));
+}
+
+// Remembers every position of the current round from the mover's side and
+// scores them once the round is over.
+class Fit_Data_Observer final : public Game_Observer {
+public:
+    Fit_Data_Observer(Eval_Fit_Data& data, const size_t game_index, std::ostream* positions, std::mutex& mutex)
+        : data_{ data }, game_index_{ game_index }, positions_{ positions }, mutex_{ mutex } {}
+
+    void on_move(const Cuarenta::Game_State& game) override {
+        const auto& mover    { Cuarenta::current_player_state(game) };
+        const auto& opponent { Cuarenta::opposing_player_state(game) };
+        pending_.push_back(Position{
+            .player = game.to_move,
+            .own_captured = std::min(mover.num_captured_cards, static_cast<int>(Bot::TableEvaluator::MAX_CAPTURED)),
+            .opp_captured = std::min(opponent.num_captured_cards, static_cast<int>(Bot::TableEvaluator::MAX_CAPTURED)),
+            .table_mask = Cuarenta::to_u16(game.table.cards),
+            .score_difference = mover.score - opponent.score });
+    }
+
+    void on_round_end(const Cuarenta::Game_State& game) override {
+        std::ostringstream rows;
+        for (const Position& p : pending_) {
+            const size_t me { Cuarenta::to_index(p.player) };
+            const int final_difference { game.players[me].score - game.players[1 - me].score };
+            const int points_to_come { final_difference - p.score_difference };
+            const int table_cards { std::popcount(p.table_mask) };
+            data_.add(p.own_captured, p.opp_captured, table_cards, points_to_come);
+
+            if (positions_) {
+                rows << game_index_ << ',' << ((p.player == Cuarenta::Player::P1) ? "P1" : "P2") << ','
+                     << p.own_captured << ',' << p.opp_captured << ',' << table_cards << ','
+                     << p.table_mask << ',' << points_to_come << '\n';
+            }
+        }
+        pending_.clear();
+
+        if (positions_) {
+            std::lock_guard lock { mutex_ };
+            *positions_ << rows.str() << std::flush;
+        }
+    }
+
+private:
+    struct Position {
+        Cuarenta::Player player;
+        int own_captured;
+        int opp_captured;
+        uint16_t table_mask;
+        int score_difference;
+    };
+
+    Eval_Fit_Data& data_;
+    size_t game_index_;
+    std::ostream* positions_;
+    std::mutex& mutex_;
+    std::vector<Position> pending_; // one round at most
+};
+
+Seat make_seat(const Bootstrap_Config& config, const std::string& name,
+               const std::shared_ptr<const Bot::Evaluator>& evaluator) {
+    Seat seat { .name = name, .bot = Bot::Bot{ config.num_mc_iters }, .depth = config.depth, .budget = {} };
+    seat.bot.evaluator_ = evaluator;
+    return seat;
+}
+
+} // namespace
+
+Eval_Fit_Data::Eval_Fit_Data()
+    : counts_(CAPTURED_SIZE * CAPTURED_SIZE * TABLE_SIZE),
+      sums_(CAPTURED_SIZE * CAPTURED_SIZE * TABLE_SIZE) {}
+
+void Eval_Fit_Data::add(const int own_captured, const int opp_captured, const int table_cards,
+                        const int points_to_come) {
+    const size_t index { cell(static_cast<size_t>(own_captured), static_cast<size_t>(opp_captured),
+                              static_cast<size_t>(table_cards)) };
+    counts_.at(index)++;
+    sums_.at(index) += points_to_come;
+    num_positions_++;
+}
+
+void Eval_Fit_Data::merge(const Eval_Fit_Data& other) {
+    for (size_t i{}; i < counts_.size(); i++) {
+        counts_[i] += other.counts_[i];
+        sums_[i]   += other.sums_[i];
+    }
+    num_positions_ += other.num_positions_;
+}
+
+Bot::TableEvaluator Eval_Fit_Data::fit(const Bot::TableEvaluator& prior, const double prior_weight) const {
+
+    constexpr size_t NUM_CAPTURED_CELLS { CAPTURED_SIZE * CAPTURED_SIZE };
+    constexpr double ONE { Bot::TableEvaluator::FIXED_POINT_ONE };
+
+    std::vector<double> captured_prior(NUM_CAPTURED_CELLS);
+    for (size_t own{}; own < CAPTURED_SIZE; own++) {
+        for (size_t opp{}; opp < CAPTURED_SIZE; opp++) {
+            captured_prior[own * CAPTURED_SIZE + opp] = prior.captured()[own][opp] / ONE;
+        }
+    }
+    // Prior table term per table size: the mean over masks of that size.
+    std::array<double, TABLE_SIZE> table_prior{};
+    std::array<double, TABLE_SIZE> masks_per_size{};
+    for (size_t mask{}; mask < Bot::TableEvaluator::NUM_TABLES; mask++) {
+        const auto size { static_cast<size_t>(std::popcount(mask)) };
+        table_prior[size] += prior.table()[mask] / ONE;
+        masks_per_size[size] += 1.0;
+    }
+    for (size_t size{}; size < TABLE_SIZE; size++) { table_prior[size] /= masks_per_size[size]; }
+
+    std::vector<double> captured { captured_prior };
+    std::array<double, TABLE_SIZE> table { table_prior };
+
+    for (int iteration{}; iteration < BACKFIT_ITERATIONS; iteration++) {
+        for (size_t size{}; size < TABLE_SIZE; size++) {
+            double numerator { prior_weight * table_prior[size] };
+            double weight    { prior_weight };
+            for (size_t c{}; c < NUM_CAPTURED_CELLS; c++) {
+                const double n { static_cast<double>(counts_[c * TABLE_SIZE + size]) };
+                numerator += static_cast<double>(sums_[c * TABLE_SIZE + size]) - n * captured[c];
+                weight    += n;
+            }
+            table[size] = numerator / weight;
+        }
+        for (size_t c{}; c < NUM_CAPTURED_CELLS; c++) {
+            double numerator { prior_weight * captured_prior[c] };
+            double weight    { prior_weight };
+            for (size_t size{}; size < TABLE_SIZE; size++) {
+                const double n { static_cast<double>(counts_[c * TABLE_SIZE + size]) };
+                numerator += static_cast<double>(sums_[c * TABLE_SIZE + size]) - n * table[size];
+                weight    += n;
+            }
+            captured[c] = numerator / weight;
+        }
+    }
+
+    Bot::TableEvaluator fitted{};
+    for (size_t own{}; own < CAPTURED_SIZE; own++) {
+        for (size_t opp{}; opp < CAPTURED_SIZE; opp++) {
+            fitted.captured()[own][opp] = to_fixed_point(captured[own * CAPTURED_SIZE + opp]);
+        }
+    }
+    for (size_t mask{}; mask < Bot::TableEvaluator::NUM_TABLES; mask++) {
+        fitted.table()[mask] = to_fixed_point(table[static_cast<size_t>(std::popcount(mask))]);
+    }
+    fitted.update_id();
+    return fitted;
+}
+
+Eval_Fit_Data collect_fit_data(const Bootstrap_Config& config, const Bot::TableEvaluator& evaluator,
+                               const uint64_t seed, const std::string& positions_path) {
+
+    std::ofstream positions{};
+    if (!positions_path.empty()) {
+        positions.open(positions_path);
+        if (!positions) { throw std::runtime_error("Could not open " + positions_path + " for writing.\n"); }
+        positions << "game,player,own_captured,opp_captured,table_cards,table_mask,points_to_come\n";
+    }
+
+    const auto shared_evaluator { std::make_shared<const Bot::TableEvaluator>(evaluator) };
+    const Seat seat { make_seat(config, "current", shared_evaluator) };
+
+    const size_t hardware { std::max<size_t>(1, std::thread::hardware_concurrency()) };
+    const size_t num_workers { std::min(
+        (config.num_threads == 0) ? hardware : config.num_threads,
+        std::max<size_t>(config.games_per_generation, 1)) };
+
+    // Counts are integers, so merging per-worker data gives the same totals
+    // however games were scheduled.
+    std::vector<Eval_Fit_Data> worker_data(num_workers);
+    std::mutex positions_mutex;
+    std::atomic<size_t> next_game { 0 };
+
+    util::ThreadPool::shared().parallel_for(num_workers, [&](const size_t worker) {
+        for (size_t index { next_game++ }; index < config.games_per_generation; index = next_game++) {
+            Fit_Data_Observer observer { worker_data[worker], index,
+                                         positions.is_open() ? &positions : nullptr, positions_mutex };
+            play_game(seat, seat, game_seed(seed, index), nullptr, nullptr, &observer);
+        }
+    });
+
+    Eval_Fit_Data data{};
+    for (const Eval_Fit_Data& partial : worker_data) { data.merge(partial); }
+    return data;
+}
+
+Bot::TableEvaluator run_bootstrap(const Bootstrap_Config& config, const Bot::TableEvaluator& initial,
+                                  std::ostream& log) {
+
+    const std::filesystem::path dir { config.output_dir };
+    std::filesystem::create_directories(dir);
+
+    Bot::TableEvaluator current { initial };
+    current.save((dir / "gen_0.txt").string());
+    current.save((dir / "best.txt").string());
+
+    std::ofstream summary_csv { dir / "generations.csv" };
+    if (!summary_csv) { throw std::runtime_error("Could not open " + (dir / "generations.csv").string() + " for writing.\n"); }
+    summary_csv << "generation,positions,gate_games,new_wins,old_wins,draws,score_rate,ci_low,ci_high,accepted,evaluator_id\n"
+                << std::flush;
+
+    for (int generation{1}; generation <= config.num_generations; generation++) {
+        const util::Timer timer{};
+        const std::string suffix { "gen_" + std::to_string(generation) };
+        const uint64_t generation_seed { Bot::splitmix64(config.seed + static_cast<uint64_t>(generation)) };
+
+        const Eval_Fit_Data data { collect_fit_data(config, current, generation_seed,
+            config.write_positions ? (dir / ("positions_" + suffix + ".csv")).string() : std::string{}) };
+        const Bot::TableEvaluator candidate { data.fit(current, config.prior_weight) };
+        candidate.save((dir / (suffix + ".txt")).string());
+
+        // New tables on seat A against the tables in use on seat B.
+        Match_Config gate{};
+        gate.seats[0] = make_seat(config, "new", std::make_shared<const Bot::TableEvaluator>(candidate));
+        gate.seats[1] = make_seat(config, "current", std::make_shared<const Bot::TableEvaluator>(current));
+        gate.num_games = config.gate_games;
+        gate.seed = Bot::splitmix64(generation_seed);
+        gate.num_threads = config.num_threads;
+        gate.output_path = (dir / ("gate_" + suffix + ".csv")).string();
+
+        std::ostream quiet { nullptr }; // per-game lines are in the gate CSV
+        const Match_Summary summary { run_match(gate, quiet) };
+        const bool accepted { summary.score_rate() > config.accept_score_rate };
+        if (accepted) {
+            current = candidate;
+            current.save((dir / "best.txt").string());
+        }
+
+        const auto [low, high] { summary.confidence_interval() };
+        summary_csv << generation << ',' << data.num_positions() << ',' << summary.num_games << ','
+                    << summary.seat_a_wins << ',' << summary.seat_b_wins << ',' << summary.draws << ','
+                    << summary.score_rate() << ',' << low << ',' << high << ','
+                    << accepted << ',' << candidate.id() << '\n' << std::flush;
+
+        log << "generation " << generation << ": " << data.num_positions() << " positions, new tables score "
+            << std::fixed << std::setprecision(3) << summary.score_rate() << " [" << low << ", " << high << "] -> "
+            << (accepted ? "accepted" : "rejected") << " (" << std::setprecision(1) << timer.elapsed_s() << " s)\n"
+            << std::defaultfloat;
+    }
+    return current;
+}
+
+} // namespace selfplay
@@ -0,0 +1,81 @@
+#pragma once
+#include "evaluator.h"
+#include "selfplay.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace selfplay {
+
+// Sufficient statistics for fitting TableEvaluator from self-play: for every
+// (own captured, opponent captured, table size) cell, how many positions were
+// seen and the points the player to move went on to gain over the opponent
+// by the end of the round. Fixed size, so collection streams over any number
+// of games.
+class Eval_Fit_Data {
+public:
+    static constexpr size_t CAPTURED_SIZE { Bot::TableEvaluator::MAX_CAPTURED + 1 };
+    static constexpr size_t TABLE_SIZE    { Cuarenta::NUM_RANKS + 1 };
+
+    Eval_Fit_Data();
+
+    void add(const int own_captured, const int opp_captured, const int table_cards, const int points_to_come);
+    void merge(const Eval_Fit_Data& other);
+    uint64_t num_positions() const { return num_positions_; }
+
+    // Least-squares fit of points_to_come ~ captured[own][opp] + table[size]
+    // by backfitting, with every entry shrunk towards `prior` by prior_weight
+    // pseudo-positions so sparse cells stay close to the previous tables.
+    // The table term is spread over every mask of the same size.
+    Bot::TableEvaluator fit(const Bot::TableEvaluator& prior, const double prior_weight) const;
+
+private:
+    static size_t cell(const size_t own, const size_t opp, const size_t table) {
+        return (own * CAPTURED_SIZE + opp) * TABLE_SIZE + table;
+    }
+
+    std::vector<uint32_t> counts_;
+    std::vector<int64_t> sums_;
+    uint64_t num_positions_{};
+};
+
+struct Bootstrap_Config {
+    int num_generations { 3 };
+    size_t games_per_generation { 200 }; // data games, current tables on both seats
+    size_t gate_games { 100 };           // new tables vs current tables
+    double accept_score_rate { 0.5 };    // new tables must score above this
+    double prior_weight { 50.0 };
+    int depth { 6 };
+    int num_mc_iters { 20 };
+    size_t num_threads { 0 };            // 0 = every hardware thread
+    uint64_t seed { 0 };
+    std::string output_dir { "bootstrap" };
+    bool write_positions { true };       // stream every position to CSV
+};
+
+struct Generation_Result {
+    int generation{};
+    uint64_t num_positions{};
+    Match_Summary gate{};
+    bool accepted{};
+    uint32_t evaluator_id{};
+};
+
+// Data collection for one generation: plays games_per_generation self-play
+// games across the thread pool and returns the merged statistics. With
+// positions_path set, every position is appended there as it is scored.
+Eval_Fit_Data collect_fit_data(const Bootstrap_Config& config, const Bot::TableEvaluator& evaluator,
+                               const uint64_t seed, const std::string& positions_path);
+
+// Runs num_generations of collect, fit and gate, starting from `initial`.
+// Each generation's fitted tables are written to gen_<k>.txt in output_dir,
+// the tables currently in use to best.txt, and a summary row to
+// generations.csv. Returns the tables in use at the end.
+Bot::TableEvaluator run_bootstrap(const Bootstrap_Config& config, const Bot::TableEvaluator& initial,
+                                  std::ostream& log);
+
+} // namespace selfplay
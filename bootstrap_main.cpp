@@ -0,0 +1,72 @@
+#include "bootstrap.h"
+#include "evaluator.h"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void print_usage() {
+    std::cout <<
+        "usage: cuarenta_bootstrap [options]\n"
+        "  --generations K    rounds of play, fit and gate (default 3)\n"
+        "  --games N          self-play games collected per generation (default 200)\n"
+        "  --gate-games N     games of new tables against the current ones (default 100)\n"
+        "  --accept RATE      score rate the new tables must beat (default 0.5)\n"
+        "  --prior-weight W   pseudo-positions pulling each entry to the current tables (default 50)\n"
+        "  --depth D          negamax depth for every move (default 6)\n"
+        "  --iters N          Monte-Carlo samples per move (default 20)\n"
+        "  --threads T        games played in parallel, 0 = all cores (default 0)\n"
+        "  --seed S           seed for every generation's games (default 0)\n"
+        "  --dir PATH         checkpoints, positions and gate results (default bootstrap)\n"
+        "  --init PATH        starting tables, e.g. a previous run's best.txt (default: score difference)\n"
+        "  --no-positions     do not write the per-position CSV files\n"
+        "The final tables are written to <dir>/best.txt; copy them to "
+        << Bot::DEFAULT_EVALUATOR_PATH << " to use them.\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    selfplay::Bootstrap_Config config{};
+    Bot::TableEvaluator initial{};
+
+    try {
+        for (int i{1}; i < argc; i++) {
+            const std::string_view arg { argv[i] };
+            if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+            if (arg == "--no-positions")        { config.write_positions = false; continue; }
+            if (i + 1 >= argc) { print_usage(); return 1; }
+            const std::string value { argv[++i] };
+
+            if      (arg == "--generations")  { config.num_generations = std::stoi(value); }
+            else if (arg == "--games")        { config.games_per_generation = std::stoul(value); }
+            else if (arg == "--gate-games")   { config.gate_games = std::stoul(value); }
+            else if (arg == "--accept")       { config.accept_score_rate = std::stod(value); }
+            else if (arg == "--prior-weight") { config.prior_weight = std::stod(value); }
+            else if (arg == "--depth")        { config.depth = std::stoi(value); }
+            else if (arg == "--iters")        { config.num_mc_iters = std::stoi(value); }
+            else if (arg == "--threads")      { config.num_threads = std::stoul(value); }
+            else if (arg == "--seed")         { config.seed = std::stoull(value); }
+            else if (arg == "--dir")          { config.output_dir = value; }
+            else if (arg == "--init")         { initial = Bot::TableEvaluator::load(value); }
+            else {
+                std::cerr << "Unknown option " << arg << '\n';
+                print_usage();
+                return 1;
+            }
+        }
+
+        const auto final_tables { selfplay::run_bootstrap(config, initial, std::cerr) };
+        std::cout << "Final tables " << config.output_dir << "/best.txt (id " << final_tables.id() << ")\n";
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
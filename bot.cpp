@@ -5,8 +5,17 @@
 #include "cuarenta.h"
 #include "movegen.h"
 #include "rank.h"
+#include "search_state.h"
+#include "transposition.h"
+#include "thread_pool.h"
+#include "work_stealing.h"
+#include "sample_stats.h"
+#include "ismcts.h"
+#include "tablebase.h"
+#include "timer.h"
 
 #include <limits>
+#include <optional>
 #include <algorithm>
 #include <bit>
 #include <utility>
@@ -17,62 +26,323 @@
 #include <cmath>
 #include <string>
 #include <cassert>
-#include <map>
+#include <span>
+#include <thread>
 
 namespace Bot {
 
-constexpr double heuristic_value(const Cuarenta::Game_State& game_state) {
+// not exposed in header
+// Exact value from the endgame tablebase, when one is loaded for this
+// evaluator and covers the position to the end of the deal.
+std::optional<double> probe_tablebase(const Cuarenta::Search_State& game_state, const int depth,
+                                      const Evaluator& evaluator) {
+    const Tablebase* tablebase { active_tablebase() };
+    if (!tablebase || tablebase->evaluator_id() != evaluator.id()) { return std::nullopt; }
+    if (const auto swing { tablebase->probe(game_state, depth) }) {
+        return evaluator.evaluate(game_state) + *swing;
+    }
+    return std::nullopt;
+}
 
-    int captured_cards_score { 0 };
+double minimax(Cuarenta::Search_State& game_state, const int depth, const Evaluator& evaluator) {
 
-    const auto& player { Cuarenta::current_player_state(game_state) };
-    const auto& enemy  { Cuarenta::opposing_player_state(game_state) };
+    if (Cuarenta::opposing_player_state(game_state).score >= 40) {
+        return std::numeric_limits<double>::lowest();
+    }
 
-    // Scoring rules: 20 cards = 6pts, 22 cards = 8pts, etc.
-    if (player.num_captured_cards >= 20) {
-            captured_cards_score += 6 + 2 * ((player.num_captured_cards - 20) / 2);
+    if (Cuarenta::current_player_state(game_state).hand.empty()) {
+        return evaluator.evaluate(game_state);
     }
 
-    if (enemy.num_captured_cards >= 20) {
-            captured_cards_score -= 6 + 2 * ((enemy.num_captured_cards - 20) / 2);
+    if (depth == 0) { return evaluator.evaluate(game_state); }
+
+    if (const auto solved { probe_tablebase(game_state, depth, evaluator) }) { return *solved; }
+
+    const auto available_moves { Cuarenta::generate_all_moves(game_state) };
+
+    double value { std::numeric_limits<double>::lowest() };
+    for (size_t i{}; i < available_moves.size(); i++) {
+
+        Cuarenta::Undo undo { Cuarenta::make_move_unchecked(game_state, Cuarenta::Move{ available_moves.at(i) } )};
+
+        game_state.advance_turn();
+        value = std::max(value, -minimax(game_state, depth - 1, evaluator));
+        game_state.unadvance_turn();
+
+        Cuarenta::undo_move_unchecked(game_state, undo);
     }
-    
-    return player.score - enemy.score + captured_cards_score;
+    return value;
 }
 
-double minimax(Cuarenta::Game_State& game_state, const int depth) {
+// not exposed in header
+// Plies until the player to move runs out of cards, when the hands have the
+// shape of a deal in progress (the mover holds as many cards as the
+// opponent, or one more); nullopt otherwise.
+std::optional<int> plies_left_in_deal(const Cuarenta::Search_State& game_state) {
+    const int mover    { Cuarenta::current_player_state(game_state).hand.size() };
+    const int opponent { Cuarenta::opposing_player_state(game_state).hand.size() };
+    if (mover != opponent && mover != opponent + 1) { return std::nullopt; }
+    return mover + opponent;
+}
+
+// not exposed in header
+// minimax() with the remaining depth fixed at compile time. The root clamps
+// Depth to the plies left in the deal, so the mover is out of cards exactly
+// at Depth 0: the out-of-cards and depth checks fold away and the last
+// levels inline into their parents.
+template <int Depth>
+double minimax_fixed(Cuarenta::Search_State& game_state, const Evaluator& evaluator) {
 
     if (Cuarenta::opposing_player_state(game_state).score >= 40) {
         return std::numeric_limits<double>::lowest();
     }
 
-    if (Cuarenta::current_player_state(game_state).hand.cards.empty()) {
-        return heuristic_value(game_state);
+    if constexpr (Depth == 0) {
+        return evaluator.evaluate(game_state);
+    } else {
+        assert(!Cuarenta::current_player_state(game_state).hand.empty());
+
+        if (const auto solved { probe_tablebase(game_state, Depth, evaluator) }) { return *solved; }
+
+        const auto available_moves { Cuarenta::generate_all_moves(game_state) };
+
+        double value { std::numeric_limits<double>::lowest() };
+        for (size_t i{}; i < available_moves.size(); i++) {
+
+            Cuarenta::Undo undo { Cuarenta::make_move_unchecked(game_state, Cuarenta::Move{ available_moves.at(i) } )};
+
+            game_state.advance_turn();
+            value = std::max(value, -minimax_fixed<Depth - 1>(game_state, evaluator));
+            game_state.unadvance_turn();
+
+            Cuarenta::undo_move_unchecked(game_state, undo);
+        }
+        return value;
     }
+}
 
-    if (depth == 0) { return heuristic_value(game_state); }
+// not exposed in header
+template <size_t... Depths>
+constexpr auto make_minimax_fixed_table(std::index_sequence<Depths...>) {
+    return std::array{ &minimax_fixed<static_cast<int>(Depths)>... };
+}
 
-    const auto available_moves { Cuarenta::generate_all_moves(game_state) };
+// not exposed in header
+constexpr auto MINIMAX_FIXED { make_minimax_fixed_table(std::make_index_sequence<MAX_FIXED_DEPTH + 1>{}) };
+
+double minimax_fixed_depth(Cuarenta::Search_State& game_state, const int depth, const Evaluator& evaluator) {
+
+    const auto plies_left { plies_left_in_deal(game_state) };
+    if (!plies_left || depth < 0) { return minimax(game_state, depth, evaluator); }
+
+    // Searching past the end of the deal changes nothing; probes past it
+    // succeed just the same at the clamped depth.
+    const int fixed { std::min(depth, *plies_left) };
+    if (fixed > MAX_FIXED_DEPTH) { return minimax(game_state, depth, evaluator); }
+    return MINIMAX_FIXED[static_cast<size_t>(fixed)](game_state, evaluator);
+}
+
+double negamax(Cuarenta::Search_State& game_state, const int depth, double alpha, double beta,
+               TranspositionTable* tt, SearchWorker* worker, const Evaluator& evaluator) {
+
+    if (worker) { worker->stats.nodes++; }
+
+    if (Cuarenta::opposing_player_state(game_state).score >= 40) {
+        return std::numeric_limits<double>::lowest();
+    }
+
+    if (Cuarenta::current_player_state(game_state).hand.empty()) {
+        return evaluator.evaluate(game_state);
+    }
+
+    if (depth == 0) { return evaluator.evaluate(game_state); }
+
+    if (const auto solved { probe_tablebase(game_state, depth, evaluator) }) { return *solved; }
+
+    // Once every remaining card fits within the horizon, deeper searches give
+    // the same value, so entries are keyed on the effective depth.
+    const int remaining_cards { Cuarenta::current_player_state(game_state).hand.size() +
+                                Cuarenta::opposing_player_state(game_state).hand.size() };
+    const int tt_depth { std::min(depth, remaining_cards) };
+    uint64_t key {};
+
+    if (tt) {
+        key = hash_state(game_state);
+        if (const auto entry { tt->probe(key) }; entry && entry->depth == tt_depth) {
+            switch (entry->bound) {
+                case Bound::Exact: return entry->value;
+                case Bound::Lower: alpha = std::max(alpha, entry->value); break;
+                case Bound::Upper: beta  = std::min(beta,  entry->value); break;
+                default: break;
+            }
+            if (alpha >= beta) { return entry->value; }
+        }
+    }
+
+    const double alpha_searched { alpha };
+    auto available_moves { Cuarenta::generate_all_moves(game_state) };
+    // Near the leaves a cutoff saves less than scoring the moves costs.
+    if (worker && worker->order_moves && depth >= 3) { worker->ordering.order(game_state, available_moves, depth); }
 
     double value { std::numeric_limits<double>::lowest() };
     for (size_t i{}; i < available_moves.size(); i++) {
 
-        Cuarenta::Undo undo { Cuarenta::make_move_in_place(game_state, Cuarenta::Move{ available_moves.at(i) } )};
+        Cuarenta::Undo undo { Cuarenta::make_move_unchecked(game_state, Cuarenta::Move{ available_moves.at(i) } )};
 
         game_state.advance_turn();
-        value = std::max(value, -minimax(game_state, depth - 1));
+        value = std::max(value, -negamax(game_state, depth - 1, -beta, -alpha, tt, worker, evaluator));
         game_state.unadvance_turn();
 
-        Cuarenta::undo_move_in_place(game_state, undo);
+        Cuarenta::undo_move_unchecked(game_state, undo);
+
+        alpha = std::max(alpha, value);
+        if (alpha >= beta) {
+            if (worker) {
+                worker->stats.cutoffs++;
+                if (i == 0) { worker->stats.first_move_cutoffs++; }
+                worker->ordering.record_cutoff(available_moves.at(i), depth);
+            }
+            break;
+        }
+    }
+
+    if (tt) {
+        const Bound bound { (value <= alpha_searched) ? Bound::Upper :
+                            (value >= beta)           ? Bound::Lower : Bound::Exact };
+        tt->store(key, TTEntry{ .value = value, .depth = tt_depth, .bound = bound });
     }
     return value;
 }
 
+double search(const Bot& bot, Cuarenta::Search_State& game_state, const int depth,
+              TranspositionTable* tt, SearchWorker* worker) {
+
+    constexpr double full_window { std::numeric_limits<double>::max() };
+
+    switch (bot.search_mode_) {
+        case SearchMode::Exhaustive:
+            return minimax_fixed_depth(game_state, depth, bot.evaluator());
+        case SearchMode::AlphaBeta:
+            return negamax(game_state, depth, -full_window, full_window, tt, worker, bot.evaluator());
+        case SearchMode::Verify: {
+            const double expected { minimax(game_state, depth, bot.evaluator()) };
+            const double actual   { negamax(game_state, depth, -full_window, full_window, tt, worker, bot.evaluator()) };
+            if (expected != actual) {
+                throw std::logic_error(
+                    "Alpha-beta search disagrees with exhaustive minimax: " + 
+                    std::to_string(actual) + " vs " + std::to_string(expected) + "\n"
+                );
+            }
+            return actual;
+        }
+    }
+    throw std::invalid_argument("Unknown search mode.\n");
+}
+
+// not exposed in header
+size_t resolve_num_threads(const Bot& bot) {
+    if (bot.num_threads_ > 0) { return static_cast<size_t>(bot.num_threads_); }
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// not exposed in header
+uint64_t resolve_base_seed(const Bot& bot) {
+    if (bot.seed_.has_value()) { return bot.seed_.value(); }
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+// not exposed in header
+// The bot's own context, or a fresh one that lives for this search only.
+std::shared_ptr<SearchContext> search_context_for(const Bot& bot) {
+    return bot.context_ ? bot.context_ : std::make_shared<SearchContext>();
+}
+
+// not exposed in header
+// Every sample (and every ISMCTS tree) owns an independent stream derived
+// from the bot's seed, the root position and its index, so results do not
+// depend on the thread count or on which worker ran it.
+uint64_t sample_seed(const uint64_t base_seed, const uint64_t root_key, const uint64_t index) {
+    return splitmix64(base_seed ^ splitmix64(root_key ^ splitmix64(index)));
+}
+
+// not exposed in header
+// Value of one root move in a fully determined world.
+double search_root_move(
+    const Bot& bot,
+    Cuarenta::Search_State& state,
+    const Cuarenta::RankMask move,
+    const int depth,
+    TranspositionTable& tt,
+    SearchWorker& worker) {
+
+    const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(state, Cuarenta::Move{ move }) };
+    state.advance_turn();
+    const double value { -search(bot, state, depth - 1, &tt, &worker) };
+    state.unadvance_turn();
+    Cuarenta::undo_move_unchecked(state, undo);
+    return value;
+}
+
+// not exposed in header
+// How a batch of independent items (samples or worlds) is cut into scheduler
+// units. With enough items for every worker to have some to steal, a unit is
+// one item; otherwise it is one (item, root move) pair, so a handful of
+// expensive items still spreads over every worker.
+struct UnitLayout {
+    size_t num_items;
+    size_t num_moves;
+    bool split_moves;
+
+    UnitLayout(const size_t items, const size_t moves, const size_t num_workers)
+        : num_items{ items }, num_moves{ moves },
+          split_moves{ moves > 1 && items < 2 * num_workers } {}
+
+    size_t num_units() const { return split_moves ? num_items * num_moves : num_items; }
+    size_t item(const size_t unit) const { return split_moves ? unit / num_moves : unit; }
+    size_t first_move(const size_t unit) const { return split_moves ? unit % num_moves : 0; }
+    size_t last_move(const size_t unit) const { return split_moves ? unit % num_moves + 1 : num_moves; }
+};
+
+// not exposed in header
+// Root move values [first_move, last_move) for one world, written to values
+// (indexed by move). Whole worlds go through the worker's memo: only the
+// opponent's hand varies, so a hand seen before is not searched again.
+void search_world(
+    const Bot& bot,
+    Cuarenta::Search_State state,
+    const Cuarenta::Packed_Hand opponent_hand,
+    const util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE>& available_moves,
+    const int depth,
+    const size_t first_move,
+    const size_t last_move,
+    TranspositionTable& tt,
+    SampleWorker& worker,
+    std::span<double> values) {
+
+    Cuarenta::opposing_player_state(state).hand = opponent_hand;
+
+    if (first_move == 0 && last_move == available_moves.size()) {
+        const auto [entry, is_new] { worker.memo.try_emplace(opponent_hand.counts) };
+        if (is_new) {
+            for (size_t i{}; i < available_moves.size(); i++) {
+                entry->second[i] = search_root_move(bot, state, available_moves.at(i), depth, tt, worker.search);
+            }
+        }
+        std::copy_n(entry->second.begin(), available_moves.size(), values.begin());
+        return;
+    }
+    for (size_t i { first_move }; i < last_move; i++) {
+        values[i] = search_root_move(bot, state, available_moves.at(i), depth, tt, worker.search);
+    }
+}
+
 // not exposed in header
 std::pair<MoveEval, std::vector<MoveEval>> get_evaluation_data (
     const Bot& bot,
-    Cuarenta::Game_State& game, 
-    const int depth) {
+    const Cuarenta::Game_State& game, 
+    const int depth,
+    SchedulerStats* scheduler_stats) {
 
     const auto available_moves { Cuarenta::generate_all_moves(game) };
 
@@ -80,145 +350,341 @@ std::pair<MoveEval, std::vector<MoveEval>> get_evaluation_data (
         std::cout << "No available moves to evaluate.\n";
         return {};
     }
-    std::vector<double> S1(available_moves.size());
-    std::vector<double> S2(available_moves.size());
-
-    const auto opp_hand_copy { Cuarenta::opposing_player_state(game).hand.cards };
-
-    int NUM_ITER { bot.num_mc_iters_ };
-
-    for (int unused{}; unused < NUM_ITER; unused++) {
-
-        for (auto& rank : Cuarenta::opposing_player_state(game).hand.cards) {
-            rank = bot.weighted_random_rank();
+    const size_t num_moves { available_moves.size() };
+    std::vector<double> S1(num_moves);
+    std::vector<double> S2(num_moves);
+
+    const Cuarenta::Search_State root { Cuarenta::to_search_state(game) };
+
+    const HandSampler sampler { bot.make_hand_sampler() };
+
+    const size_t num_samples { static_cast<size_t>(std::max(bot.num_mc_iters_, 0)) };
+    util::WorkStealingScheduler scheduler { resolve_num_threads(bot) };
+    const uint64_t base_seed { resolve_base_seed(bot) };
+    const uint64_t root_key  { hash_state(root) };
+
+    // The table is shared by every world and thread, since subtrees recur
+    // across opponent hands, and by the bot's later decisions in this deal.
+    const auto context { search_context_for(bot) };
+    context->prepare(bot.evaluator().id(), root_key, depth, scheduler.num_workers());
+    TranspositionTable& tt { context->tt() };
+    std::vector<SampleWorker>& workers { context->workers() };
+
+    // Late in a deal the opponent can only hold a handful of distinct hands.
+    // When there are no more of them than samples, every one is searched once
+    // and weighted by its exact probability instead.
+    const int opp_hand_size { Cuarenta::opposing_player_state(root).hand.size() };
+    const auto worlds { sampler.enumerate(opp_hand_size, num_samples) };
+    const bool exact { !worlds.empty() };
+    const size_t num_items { exact ? worlds.size() : num_samples };
+
+    // Each item's values land in its own row and are summed in item order
+    // afterwards, so a fixed seed gives bit-identical results.
+    const UnitLayout layout { num_items, num_moves, scheduler.num_workers() };
+    std::vector<double> item_values(num_items * num_moves);
+
+    scheduler.run(layout.num_units(), [&](const size_t worker, const size_t unit) {
+        const size_t item { layout.item(unit) };
+        Cuarenta::Packed_Hand hand{};
+        if (exact) {
+            hand = worlds[item].hand;
+        } else {
+            SampleRng gen { sample_seed(base_seed, root_key, item) };
+            hand = sampler.sample(opp_hand_size, gen);
         }
-
-        for (size_t i{}; i < available_moves.size(); i++) {
-
-            const Cuarenta::Undo undo { Cuarenta::make_move_in_place(game, Cuarenta::Move{available_moves.at(i)}) };
-            game.advance_turn();
-            double value = -minimax(game, depth - 1);
-            game.unadvance_turn();
-            Cuarenta::undo_move_in_place(game, undo);
-            
-            S1[i] += value;
-            S2[i] += value * value;
+        search_world(bot, root, hand, available_moves, depth, layout.first_move(unit), layout.last_move(unit),
+                     tt, workers[worker], std::span<double>{ item_values.data() + item * num_moves, num_moves });
+    });
+
+    double total_weight {};
+    for (size_t item{}; item < num_items; item++) {
+        const double p { exact ? worlds[item].probability : 1.0 };
+        total_weight += p;
+        for (size_t i{}; i < num_moves; i++) {
+            const double value { std::clamp(item_values[item * num_moves + i], -DECIDED_GAME_VALUE, DECIDED_GAME_VALUE) };
+            S1[i] += p * value;
+            S2[i] += p * value * value;
         }
-        Cuarenta::opposing_player_state(game).hand.cards = opp_hand_copy;
     }
+    if (scheduler_stats) { *scheduler_stats = scheduler.stats(); }
 
     std::vector<MoveEval> move_evaluations;
-    MoveEval best_move { .eval = std::numeric_limits<double>::lowest(), 
-                         .move = {},
+    MoveEval best_move { .move = {},
+                         .eval = std::numeric_limits<double>::lowest(),
                          .std_dev = {}}; 
     move_evaluations.reserve(available_moves.size());
 
     for (size_t i{}; i < available_moves.size(); i++) {
-        const double mean { S1[i] / NUM_ITER };
-        const double var  { S2[i] / NUM_ITER - mean * mean };
+        const double mean { S1[i] / total_weight };
+        const double var  { S2[i] / total_weight - mean * mean };
         move_evaluations.emplace_back(MoveEval{ 
             .move = Cuarenta::Move{available_moves.at(i)},
             .eval = mean,
             .std_dev = std::sqrt(std::max(0.0, var))
         });
-        if (mean > best_move.eval) { best_move = move_evaluations.back(); }
+        if (i == 0 || mean > best_move.eval) { best_move = move_evaluations.back(); }
     }
     return std::pair<MoveEval, std::vector<MoveEval>>{best_move, move_evaluations};
 }
 
-Cuarenta::Move choose_best_move(const Bot& bot, Cuarenta::Game_State game, const int depth) {
-    return get_evaluation_data(bot, game, depth).first.move;
+Cuarenta::Move choose_best_move(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                SchedulerStats* scheduler_stats) {
+    if (bot.engine_ == SearchEngine::Ismcts) {
+        return evaluate_with_ismcts(bot, game, depth, SearchBudget{}, {}, scheduler_stats).best_move.move;
+    }
+    return get_evaluation_data(bot, game, depth, scheduler_stats).first.move;
 }
 
-std::vector<MoveEval> evaluate_all_moves(const Bot& bot, Cuarenta::Game_State game, const int depth) {
-    return get_evaluation_data(bot, game, depth).second;
+std::vector<MoveEval> evaluate_all_moves(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                         SchedulerStats* scheduler_stats) {
+    if (bot.engine_ == SearchEngine::Ismcts) {
+        return evaluate_with_ismcts(bot, game, depth, SearchBudget{}, {}, scheduler_stats).moves;
+    }
+    return get_evaluation_data(bot, game, depth, scheduler_stats).second;
 }
 
-std::pair<MoveEval, bool> determine_if_confident (
-    const Bot& bot,
-    Cuarenta::Game_State& game, 
-    const int depth) {
+IsmctsResult evaluate_with_ismcts(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                  const SearchBudget& budget, std::stop_token stop,
+                                  SchedulerStats* scheduler_stats) {
+
+    constexpr uint64_t CLOCK_CHECK_INTERVAL { 64 };
+
+    const Cuarenta::Search_State root { Cuarenta::to_search_state(game) };
+    const auto available_moves { Cuarenta::generate_all_moves(root) };
+    if (available_moves.empty()) { return {}; }
+
+    const HandSampler sampler { bot.make_hand_sampler() };
+    const uint64_t max_iterations { static_cast<uint64_t>(std::max(
+        (budget.max_samples > 0) ? budget.max_samples : bot.num_mc_iters_, 1)) };
+    const auto deadline { (budget.time_limit > std::chrono::milliseconds::zero())
+        ? util::Timer::Clock::now() + budget.time_limit
+        : util::Timer::Clock::time_point::max() };
+
+    // Root parallelism: one tree per thread, each a scheduler unit with its
+    // own stream, merged per root move in tree order.
+    const size_t num_tasks   { std::clamp<size_t>(resolve_num_threads(bot), 1, max_iterations) };
+    const uint64_t base_seed { resolve_base_seed(bot) };
+    const uint64_t root_key  { hash_state(root) };
+    std::vector<std::vector<IsmctsTree::RootStats>> task_stats(num_tasks);
+    util::WorkStealingScheduler scheduler { num_tasks };
+
+    scheduler.run(num_tasks, [&](size_t, const size_t task) {
+        std::mt19937 gen { static_cast<uint32_t>(sample_seed(base_seed, root_key, task)) };
+        IsmctsTree tree { root, sampler, bot.evaluator(), depth };
+        const uint64_t iterations { max_iterations * (task + 1) / num_tasks - max_iterations * task / num_tasks };
+
+        for (uint64_t i{}; i < iterations; i++) {
+            if (i % CLOCK_CHECK_INTERVAL == 0 && i > 0 &&
+                (stop.stop_requested() || util::Timer::Clock::now() >= deadline)) { break; }
+            tree.iterate(gen);
+        }
+        task_stats[task] = tree.root_stats();
+    });
 
-    const auto available_moves { Cuarenta::generate_all_moves(game) };
+    IsmctsResult result{};
+    for (size_t i{}; i < available_moves.size(); i++) {
+        uint64_t visits {};
+        double sum {};
+        double sum_sq {};
+        for (const auto& stats : task_stats) {
+            const IsmctsTree::RootStats& s { stats[i] };
+            visits += s.visits;
+            sum    += s.mean * s.visits;
+            sum_sq += (s.std_dev * s.std_dev + s.mean * s.mean) * s.visits;
+        }
+        const double n    { static_cast<double>(visits) };
+        const double mean { (visits > 0) ? sum / n : 0.0 };
+        result.moves.push_back(MoveEval{
+            .move = Cuarenta::Move{ available_moves.at(i) },
+            .eval = mean,
+            .std_dev = (visits > 0) ? std::sqrt(std::max(0.0, sum_sq / n - mean * mean)) : 0.0 });
+        result.visits.push_back(visits);
+        result.num_iterations += visits;
+    }
+    const auto most_visited { std::ranges::max_element(result.visits) - result.visits.begin() };
+    result.best_move = result.moves[static_cast<size_t>(most_visited)];
+    if (scheduler_stats) { *scheduler_stats = scheduler.stats(); }
+    return result;
+}
 
-    if (available_moves.empty()) {
-        std::cout << "No available moves to evaluate.\n";
-        return {};
+AnytimeSearch::AnytimeSearch(const Bot& bot, const Cuarenta::Game_State& game, const int depth)
+    : bot_{ bot },
+      root_{ Cuarenta::to_search_state(game) },
+      depth_{ depth },
+      available_moves_{ Cuarenta::generate_all_moves(root_) },
+      sampler_{ bot.make_hand_sampler() },
+      base_seed_{ resolve_base_seed(bot) },
+      root_key_{ hash_state(root_) },
+      scheduler_{ resolve_num_threads(bot) },
+      context_{ search_context_for(bot) },
+      stats_{ available_moves_.size() } {}
+
+size_t AnytimeSearch::run_batch(
+    const size_t num_samples,
+    const util::Timer::Clock::time_point deadline,
+    std::stop_token stop) {
+
+    if (available_moves_.empty() || num_samples == 0) { return 0; }
+
+    const size_t num_moves { available_moves_.size() };
+    const size_t first_sample { next_sample_ };
+    next_sample_ += num_samples;
+
+    // Prepared per batch: another search may have used the context since.
+    context_->prepare(bot_.evaluator().id(), root_key_, depth_, scheduler_.num_workers());
+    TranspositionTable& tt { context_->tt() };
+    std::vector<SampleWorker>& workers { context_->workers() };
+
+    const UnitLayout layout { num_samples, num_moves, scheduler_.num_workers() };
+    std::vector<double> sample_values(num_samples * num_moves);
+    std::vector<uint8_t> unit_done(layout.num_units());
+    const int opp_hand_size { Cuarenta::opposing_player_state(root_).hand.size() };
+
+    scheduler_.run(layout.num_units(), [&](const size_t worker, const size_t unit) {
+        if (stop.stop_requested() || util::Timer::Clock::now() >= deadline) { return; }
+
+        const size_t sample { layout.item(unit) };
+        SampleRng gen { sample_seed(base_seed_, root_key_, first_sample + sample) };
+        search_world(bot_, root_, sampler_.sample(opp_hand_size, gen), available_moves_, depth_,
+                     layout.first_move(unit), layout.last_move(unit), tt, workers[worker],
+                     std::span<double>{ sample_values.data() + sample * num_moves, num_moves });
+        unit_done[unit] = 1;
+    });
+
+    // Completed samples are merged in sample order; a sample split over root
+    // moves counts once all of its moves are done.
+    size_t num_completed {};
+    for (size_t sample{}; sample < num_samples; sample++) {
+        const size_t units_per_sample { layout.split_moves ? num_moves : 1 };
+        bool done { true };
+        for (size_t u{}; u < units_per_sample; u++) { done = done && unit_done[sample * units_per_sample + u]; }
+        if (!done) { continue; }
+        stats_.add(std::span<const double>{ sample_values.data() + sample * num_moves, num_moves });
+        num_completed++;
     }
+    return num_completed;
+}
 
-    std::vector<double> S1(available_moves.size());
-    std::vector<double> S2(available_moves.size());
-    std::map<std::pair<size_t, size_t>, double> S1_diff{};
-    std::map<std::pair<size_t, size_t>, double> S2_diff{};
+size_t AnytimeSearch::leader() const {
+    size_t best {};
+    for (size_t i{1}; i < available_moves_.size(); i++) {
+        if (stats_.mean(i) > stats_.mean(best)) { best = i; }
+    }
+    return best;
+}
 
-    const auto opp_hand_copy { Cuarenta::opposing_player_state(game).hand.cards };
+bool AnytimeSearch::is_confident(const double z_score, const double epsilon) const {
+    if (available_moves_.size() <= 1) { return true; }
+    if (stats_.count() < MIN_SAMPLES_FOR_CONFIDENCE) { return false; }
 
-    int NUM_ITER { bot.num_mc_iters_ };
+    const size_t best { leader() };
+    size_t runner_up { (best == 0) ? size_t{1} : size_t{0} };
+    for (size_t i{}; i < available_moves_.size(); i++) {
+        if (i != best && stats_.mean(i) > stats_.mean(runner_up)) { runner_up = i; }
+    }
 
-    for (int unused{}; unused < NUM_ITER; unused++) {
+    // Paired CLT bound on (best - runner_up): stop once the runner-up cannot
+    // be more than epsilon better than the leader.
+    const double lower { stats_.diff_mean(best, runner_up) - z_score * stats_.diff_std_error(best, runner_up) };
+    return lower > -epsilon;
+}
 
-        for (auto& rank : Cuarenta::opposing_player_state(game).hand.cards) {
-            rank = bot.weighted_random_rank();
-        }
+MoveEval AnytimeSearch::best() const {
+    if (available_moves_.empty()) { return {}; }
+    const size_t best { leader() };
+    return MoveEval{ .move = Cuarenta::Move{ available_moves_.at(best) },
+                     .eval = stats_.mean(best),
+                     .std_dev = std::sqrt(stats_.variance(best)) };
+}
 
-        std::vector<double> temp_moves_S1(available_moves.size());
-        std::vector<double> temp_moves_S2(available_moves.size());
-        for (size_t i{}; i < available_moves.size(); i++) {
+std::vector<MoveEval> AnytimeSearch::evaluations() const {
+    std::vector<MoveEval> move_evaluations;
+    move_evaluations.reserve(available_moves_.size());
+    for (size_t i{}; i < available_moves_.size(); i++) {
+        move_evaluations.emplace_back(MoveEval{
+            .move = Cuarenta::Move{ available_moves_.at(i) },
+            .eval = stats_.mean(i),
+            .std_dev = std::sqrt(stats_.variance(i)) });
+    }
+    return move_evaluations;
+}
 
-            const Cuarenta::Undo undo { Cuarenta::make_move_in_place(game, Cuarenta::Move{available_moves.at(i)}) };
-            game.advance_turn();
-            double value { -minimax(game, depth - 1) };
-            game.unadvance_turn();
-            Cuarenta::undo_move_in_place(game, undo);
+Cuarenta::Move choose_best_move(
+    const Bot& bot,
+    const Cuarenta::Game_State& game,
+    const int depth,
+    const SearchBudget& budget,
+    std::stop_token stop,
+    SchedulerStats* scheduler_stats) {
+
+    if (bot.engine_ == SearchEngine::Ismcts) {
+        return evaluate_with_ismcts(bot, game, depth, budget, stop, scheduler_stats).best_move.move;
+    }
 
-            S1[i] += value;
-            S2[i] += value;
-            temp_moves_S1[i] = value;
-            temp_moves_S2[i] = value * value;
-        }
-        Cuarenta::opposing_player_state(game).hand.cards = opp_hand_copy;
+    AnytimeSearch anytime { bot, game, depth };
 
-        for (size_t i{}; i < available_moves.size(); i++) {
-            for (size_t j{}; j < available_moves.size(); j++) {
-                if (i >= j) { continue; }
-                S1_diff[std::pair<size_t, size_t>{i, j}] += (temp_moves_S1[j] - temp_moves_S1[i]);
-                S2_diff[std::pair<size_t, size_t>{i, j}] += ((temp_moves_S2[j] - temp_moves_S1[i]) * (temp_moves_S2[j] - temp_moves_S1[i]));
-            }
-        }
+    const auto deadline { (budget.time_limit > std::chrono::milliseconds::zero()) 
+        ? util::Timer::Clock::now() + budget.time_limit
+        : util::Timer::Clock::time_point::max() };
+    const size_t max_samples { static_cast<size_t>(std::max(
+        (budget.max_samples > 0) ? budget.max_samples : bot.num_mc_iters_, 1)) };
+    const size_t batch_size { static_cast<size_t>(std::max(budget.batch_size, 1)) };
+
+    while (anytime.num_samples() < max_samples) {
+        const size_t batch { std::min(batch_size, max_samples - anytime.num_samples()) };
+        if (anytime.run_batch(batch, deadline, stop) < batch) { break; } // deadline or stop
+        if (anytime.is_confident(budget.z_score, budget.epsilon)) { break; }
     }
+    if (scheduler_stats) { *scheduler_stats = anytime.scheduler_stats(); }
+    return anytime.best().move;
+}
 
-    std::vector<MoveEval> move_evaluations;
-    bool is_confident {true};
-    MoveEval best_move { .eval = std::numeric_limits<double>::lowest(), 
-                         .move = {},
-                         .std_dev = {}}; 
-    move_evaluations.reserve(available_moves.size());
+ConfidenceReport AnytimeSearch::confidence_report(const double z_score) const {
 
-    for (size_t i{}; i < available_moves.size(); i++) {
-        const double mean { S1[i] / NUM_ITER };
-        const double var  { S2[i] / NUM_ITER - mean * mean };
-        move_evaluations.emplace_back(MoveEval{ 
-            .move = Cuarenta::Move{available_moves.at(i)},
-            .eval = mean,
-            .std_dev = std::sqrt(std::max(0.0, var))
-        });
-        if (mean > best_move.eval) { best_move = move_evaluations.back(); }
+    ConfidenceReport report { .best_move = best(),
+                              .moves = {},
+                              .num_samples = stats_.count(),
+                              .is_confident = true };
+    if (available_moves_.empty()) { return report; }
+
+    const size_t best_idx { leader() };
+    report.moves.reserve(available_moves_.size());
+
+    for (size_t i{}; i < available_moves_.size(); i++) {
+        const double diff      { stats_.diff_mean(best_idx, i) };
+        const double std_error { stats_.diff_std_error(best_idx, i) };
+        const bool separated   { (i == best_idx) || (diff - z_score * std_error > 0.0) };
+
+        report.moves.emplace_back(MoveConfidence{
+            .eval = MoveEval{ .move = Cuarenta::Move{ available_moves_.at(i) },
+                              .eval = stats_.mean(i),
+                              .std_dev = std::sqrt(stats_.variance(i)) },
+            .diff_from_best = diff,
+            .diff_std_error = std_error,
+            .is_separated = separated });
+
+        report.is_confident = report.is_confident && separated;
     }
+    return report;
+}
 
-    assert(S1_diff.size() == (available_moves.size() * (available_moves.size() - 1) / 2));
-    for (const auto& [idx, val] : S1_diff) {
-        const double mean {S1_diff[idx] / NUM_ITER};
-        const double var {S2_diff[idx] / NUM_ITER - mean * mean};
-        const double stddev = std::sqrt(std::max(0.0, var));
+ConfidenceReport determine_if_confident (
+    const Bot& bot,
+    const Cuarenta::Game_State& game, 
+    const int depth,
+    const double z_score,
+    SchedulerStats* scheduler_stats) {
 
-        // 99.9%
-        const double lower = mean - 3.29053 * stddev;
-        const double upper = mean + 3.29053 * stddev;
-        if(lower <= 0.0 && upper >= 0.0) { is_confident = false; }
+    AnytimeSearch anytime { bot, game, depth };
+
+    if (anytime.num_moves() == 0) {
+        std::cout << "No available moves to evaluate.\n";
+        return {};
     }
 
-    return std::pair<MoveEval, bool>{best_move, is_confident};
+    anytime.run_batch(static_cast<size_t>(std::max(bot.num_mc_iters_, 0)));
+    if (scheduler_stats) { *scheduler_stats = anytime.scheduler_stats(); }
+    return anytime.confidence_report(z_score);
 }
 
-
 }
\ No newline at end of file
@@ -2,77 +2,115 @@
 #include "cuarenta.h"
 #include "dynamic_array.h"
 #include "game_state.h"
+#include "search_state.h"
 #include "rank.h"
 #include "ansi.h"
+#include "transposition.h"
+#include "sample_stats.h"
+#include "hand_sampler.h"
+#include "inference.h"
+#include "evaluator.h"
+#include "move_ordering.h"
+#include "search_context.h"
+#include "timer.h"
+#include "work_stealing.h"
 #include <vector>
 #include <array>
 #include <utility>
-#include <map>
+#include <optional>
+#include <memory>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include <stop_token>
 
 namespace Bot {
 
+// Per-worker task, steal and idle counters of one evaluation.
+using SchedulerStats = std::vector<util::WorkerStats>;
+
 struct MoveEval {
     Cuarenta::Move move;
     double eval; // negamax value from the current player's perspective
     double std_dev;
 };
 
-struct RankProbability {
-    double probability_weight { 1.0 };
-    int count { 4 };
-};
+// Exhaustive: plain minimax over every child (reference implementation)
+// AlphaBeta:  fail-soft alpha-beta negamax, same root values with cutoffs
+// Verify:     runs both and throws if they ever disagree
+enum class SearchMode : uint8_t { Exhaustive, AlphaBeta, Verify };
+
+// Pimc:   perfect-information Monte Carlo, every sampled deal searched with
+//         search_mode_ (default)
+// Ismcts: one information-set MCTS tree over all deals, see ismcts.h;
+//         num_mc_iters_ counts tree iterations instead of samples
+enum class SearchEngine : uint8_t { Pimc, Ismcts };
 
 struct Bot {
-    std::map<Cuarenta::Rank, RankProbability> hand_prob {
-        { Cuarenta::Rank::Ace,   RankProbability{} },
-        { Cuarenta::Rank::Two,   RankProbability{} },
-        { Cuarenta::Rank::Three, RankProbability{} },
-        { Cuarenta::Rank::Four,  RankProbability{} },
-        { Cuarenta::Rank::Five,  RankProbability{} },
-        { Cuarenta::Rank::Six,   RankProbability{} },
-        { Cuarenta::Rank::Seven, RankProbability{} },
-        { Cuarenta::Rank::Jack,  RankProbability{} },
-        { Cuarenta::Rank::Queen, RankProbability{} },
-        { Cuarenta::Rank::King,  RankProbability{} },
-    };
+    RankProbabilities hand_prob { full_deck_probabilities() };
     int num_mc_iters_;
+    SearchMode search_mode_;
+    int num_threads_;                 // 0 = every hardware thread
+    std::optional<uint64_t> seed_ {}; // fixed seed => reproducible PIMC for any thread count
+    std::shared_ptr<const Evaluator> evaluator_ {}; // null = default_evaluator()
+    SearchEngine engine_ { SearchEngine::Pimc };
+    std::shared_ptr<SearchContext> context_ {}; // null = every decision starts cold
+
+    Bot(int num_mc_iters, SearchMode search_mode = SearchMode::AlphaBeta, int num_threads = 1) : 
+        num_mc_iters_{num_mc_iters},
+        search_mode_{search_mode},
+        num_threads_{num_threads} {}
 
-    Bot(int num_mc_iters) : 
-        num_mc_iters_{num_mc_iters} {}
+    RankProbability& prob(const Cuarenta::Rank rank) {
+        return hand_prob[static_cast<size_t>(Cuarenta::rank_to_int(rank))];
+    }
 
-    // todo: add multipliers for caida/limpia?
+    // Removes a card the opponent can no longer hold.
     void update_from_move(Cuarenta::Move enemy_move) {
         const auto played_card { enemy_move.get_played_rank() };
-        assert(hand_prob[played_card].count >= 1);
-        hand_prob[played_card].count--;
+        assert(prob(played_card).count >= 1);
+        prob(played_card).count--;
+    }
+
+    // Opponent move with the table it was played on, which also feeds the
+    // caida/limpia inference.
+    void update_from_move(Cuarenta::Move enemy_move, const Cuarenta::Table& table_before) {
+        update_from_move(enemy_move);
+        observe_opponent_move(hand_prob, table_before, enemy_move);
     }
 
+    // Called with the bot's own hand on every deal. The opponent holds a new
+    // hand too, so the evidence gathered on the last one is dropped.
     void update_from_hand(const Cuarenta::Hand hand) {
+        if (context_) { context_->clear(); }
+        reset_weights(hand_prob);
         for (const auto& card : hand.cards) {
             update_from_move(Cuarenta::Move{to_mask(card)});
         }
     }
     void reset_probabilities() {
-        for (auto& [rank, prob] : hand_prob) {
-            prob = RankProbability{};
-        }
+        if (context_) { context_->clear(); }
+        hand_prob = full_deck_probabilities();
     }
 
-    Cuarenta::Rank weighted_random_rank() const {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
+    const Evaluator& evaluator() const { return evaluator_ ? *evaluator_ : default_evaluator(); }
 
+    // Snapshot of the unseen cards for dealing whole opponent hands.
+    HandSampler make_hand_sampler() const { return HandSampler{ hand_prob }; }
+
+    // Single card drawn with replacement; make_hand_sampler() deals whole hands.
+    Cuarenta::Rank weighted_random_rank(std::mt19937& gen) const {
         double tot_sum{};
-        for (const auto& [rank, rank_prob] : hand_prob) {
+        for (const RankProbability& rank_prob : hand_prob) {
             tot_sum += rank_prob.count * rank_prob.probability_weight;
         }
 
         std::uniform_real_distribution<double> dis(0, tot_sum);
         double rand { dis(gen) };
 
-        for (const auto& [rank, rank_prob] : hand_prob) {
-            rand -= rank_prob.count * rank_prob.probability_weight;
-            if (rand <= 0) { return rank; }
+        for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+            rand -= hand_prob[i].count * hand_prob[i].probability_weight;
+            if (rand <= 0) { return Cuarenta::int_to_rank(static_cast<int>(i)); }
         }
         throw std::out_of_range("Error with monte-carlo RNG generation");
     }
@@ -81,13 +119,131 @@ struct Bot {
 const static Bot BOT_CHILD { Bot{ 1 } };
 const static Bot BOT_ROBOT { Bot{ 10 } };
 const static Bot BOT_MAN   { Bot{ 1000 } };
-const static Bot BOT_CHEAT { Bot{ 10000 } };
+const static Bot BOT_CHEAT { Bot{ 10000, SearchMode::AlphaBeta, 0 } };
 
 constexpr double heuristic_value(const Cuarenta::Game_State& game, int round);
 
-double minimax(Cuarenta::Game_State& game, const int depth);
+double minimax(Cuarenta::Search_State& game, const int depth,
+               const Evaluator& evaluator = default_evaluator());
+
+// minimax() dispatched once at the root to a search specialised on the
+// remaining depth, clamped to the plies left in the deal. Same values as
+// minimax(); positions deeper than MAX_FIXED_DEPTH, or whose hands cannot
+// arise in a deal, take the runtime-depth path.
+inline constexpr int MAX_FIXED_DEPTH { 10 };
+double minimax_fixed_depth(Cuarenta::Search_State& game, const int depth,
+                           const Evaluator& evaluator = default_evaluator());
+
+// Fail-soft: the returned value may lie outside [alpha, beta]. Inside the
+// window it is exact, so a full window at the root matches minimax().
+// The optional transposition table is only trusted for entries searched to the
+// same effective depth, so the results stay identical to minimax().
+// With a worker, moves are tried in MoveOrdering order and the worker's
+// stats count nodes and cutoffs; ordering changes speed, never the value.
+double negamax(Cuarenta::Search_State& game, const int depth, double alpha, double beta,
+               TranspositionTable* tt = nullptr, SearchWorker* worker = nullptr,
+               const Evaluator& evaluator = default_evaluator());
+double search(const Bot& bot, Cuarenta::Search_State& game, const int depth,
+              TranspositionTable* tt = nullptr, SearchWorker* worker = nullptr);
+
+// Work is split into (sample) or (sample, root move) units and balanced over
+// the bot's threads by work stealing; scheduler_stats receives per-thread
+// task, steal and idle counters when given.
+Cuarenta::Move choose_best_move(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                SchedulerStats* scheduler_stats = nullptr);
+
+struct SearchBudget {
+    std::chrono::milliseconds time_limit { std::chrono::milliseconds::zero() }; // zero = no deadline
+    int max_samples { 0 };    // zero = bot.num_mc_iters_
+    int batch_size  { 32 };
+    double z_score  { 3.29053 }; // 99.9%, two-sided
+    double epsilon  { 0.25 };    // runner-up may be at most this much better
+};
+
+struct MoveConfidence {
+    MoveEval eval;
+    double diff_from_best; // mean of (best - this move) over the same samples
+    double diff_std_error;
+    bool is_separated;     // confidence interval of the difference excludes 0
+};
+
+struct ConfidenceReport {
+    MoveEval best_move;
+    std::vector<MoveConfidence> moves;
+    size_t num_samples;
+    bool is_confident;     // every other move is separated from the best
+};
+
+// PIMC over a fixed root that can be extended in batches. The current best
+// move is available between batches, so callers can stop at any time.
+class AnytimeSearch {
+public:
+    static constexpr size_t MIN_SAMPLES_FOR_CONFIDENCE { 30 };
+
+    AnytimeSearch(const Bot& bot, const Cuarenta::Game_State& game, const int depth);
+
+    // Runs up to num_samples more samples across the bot's threads, stopping
+    // early at the deadline or on a stop request. Returns samples completed.
+    size_t run_batch(const size_t num_samples,
+                     const util::Timer::Clock::time_point deadline = util::Timer::Clock::time_point::max(),
+                     std::stop_token stop = {});
+
+    // True once the paired confidence interval separates the leader from the
+    // runner-up (up to epsilon).
+    bool is_confident(const double z_score, const double epsilon) const;
+
+    // Compares every move against the current leader on paired differences.
+    ConfidenceReport confidence_report(const double z_score) const;
+
+    MoveEval best() const;
+    std::vector<MoveEval> evaluations() const;
+    size_t num_samples() const { return stats_.count(); }
+    size_t num_moves() const { return available_moves_.size(); }
+    SearchStats search_stats() const { return context_->search_stats(); } // since the root last changed
+    const SchedulerStats& scheduler_stats() const { return scheduler_.stats(); }
+
+private:
+    size_t leader() const;
+
+    Bot bot_;
+    Cuarenta::Search_State root_;
+    int depth_;
+    util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE> available_moves_;
+    HandSampler sampler_;
+    uint64_t base_seed_;
+    uint64_t root_key_;
+    uint64_t next_sample_{}; // global index of the next sample, which picks its stream
+    util::WorkStealingScheduler scheduler_;
+    std::shared_ptr<SearchContext> context_; // the bot's, or one of its own
+    SampleStats stats_;
+};
+
+// Samples in batches until the budget runs out or the best move is
+// statistically separated from the runner-up.
+Cuarenta::Move choose_best_move(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                const SearchBudget& budget, std::stop_token stop = {},
+                                SchedulerStats* scheduler_stats = nullptr);
+
+std::vector<MoveEval> evaluate_all_moves(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                         SchedulerStats* scheduler_stats = nullptr);
+
+struct IsmctsResult {
+    MoveEval best_move;          // most visited root move
+    std::vector<MoveEval> moves; // generate_all_moves order
+    std::vector<uint64_t> visits;
+    uint64_t num_iterations{};
+};
+
+// Information-set MCTS from the bot's view of game, one tree per thread with
+// the root statistics merged. Runs budget.max_samples iterations (zero =
+// bot.num_mc_iters_) unless the time limit or stop comes first.
+IsmctsResult evaluate_with_ismcts(const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                  const SearchBudget& budget, std::stop_token stop = {},
+                                  SchedulerStats* scheduler_stats = nullptr);
 
-Cuarenta::Move choose_best_move(const Bot& bot, Cuarenta::Game_State game, const int depth);
-std::vector<MoveEval> evaluate_all_moves(const Bot& bot, Cuarenta::Game_State game, const int depth);
-std::pair<MoveEval, bool> determine_if_confident (const Bot& bot, Cuarenta::Game_State& game, const int depth);
+// Runs num_mc_iters_ samples and reports, per move, whether its paired
+// difference to the best move is significant (99.9% by default).
+ConfidenceReport determine_if_confident (const Bot& bot, const Cuarenta::Game_State& game, const int depth,
+                                         const double z_score = 3.29053,
+                                         SchedulerStats* scheduler_stats = nullptr);
 }
\ No newline at end of file
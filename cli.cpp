@@ -6,6 +6,7 @@
 #include "movegen.h"
 #include "bot.h"
 #include "game_state.h"
+#include "ponder.h"
 #include "rank.h"
 
 #include <algorithm>
@@ -15,6 +16,7 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -170,8 +172,20 @@ Bot::Bot bot_selection_screen() {
     }
 }
 
-size_t choose_move_ai(Cuarenta::Game_State& game, Bot::Bot bot, int depth) {
-    auto evals = Bot::evaluate_all_moves(bot, game, depth);
+// A pondered search for this position is topped up to the bot's sample
+// count; without one the bot evaluates from scratch.
+size_t choose_move_ai(Cuarenta::Game_State& game, Bot::Bot bot, int depth, Bot::Ponderer* ponderer = nullptr) {
+    const auto moves { Cuarenta::generate_all_moves(game) };
+    std::unique_ptr<Bot::AnytimeSearch> pondered { ponderer ? ponderer->take(game) : nullptr };
+
+    std::vector<Bot::MoveEval> evals;
+    if (pondered) {
+        const size_t target { ponderer->max_samples() };
+        if (pondered->num_samples() < target) { pondered->run_batch(target - pondered->num_samples()); }
+        evals = pondered->evaluations();
+    } else {
+        evals = Bot::evaluate_all_moves(bot, game, depth);
+    }
     if (evals.empty()) { return 0; }
     size_t best_idx{};
     double best_val = evals.front().eval;
@@ -181,13 +195,25 @@ size_t choose_move_ai(Cuarenta::Game_State& game, Bot::Bot bot, int depth) {
             best_idx = i;
         }
     }
-    return best_idx;
+    // Search_State and Game_State roots may list moves in different orders.
+    const size_t idx { moves.find(evals[best_idx].move.targets_mask) };
+    return (idx != moves.size()) ? idx : 0;
 }
 
 void run_game(std::optional<Bot::Bot> bot) {
 
+    constexpr int BOT_DEPTH { 10 };
+
     Cuarenta::Game_State game{};
 
+    // Searches the bot's replies while the human is thinking; destroyed (and
+    // so cancelled) on every way out of the game.
+    std::optional<Bot::Ponderer> ponderer{};
+    if (bot.has_value()) {
+        bot->context_ = std::make_shared<Bot::SearchContext>();
+        ponderer.emplace(bot.value(), BOT_DEPTH);
+    }
+
     bool versus_bot{};
     if (bot.has_value()) { versus_bot = true; }
     else                 { versus_bot = false; }
@@ -212,6 +238,8 @@ void run_game(std::optional<Bot::Bot> bot) {
                 current.hand  = game.deck.draw_hand();
                 opponent.hand = game.deck.draw_hand();
             }
+            // Positions from the last deal will not come up again.
+            if (bot.has_value() && bot->context_) { bot->context_->clear(); }
         }
 
         bool current_is_human = true;
@@ -229,6 +257,7 @@ void run_game(std::optional<Bot::Bot> bot) {
         size_t chosen{};
 
         if (current_is_human) {
+            if (ponderer) { ponderer->start(game); }
             while (true) {
                 std::cout << "\n\nEnter move (e.g., '5' or '5 = 3 + 2'), "
                              "'help' for commands, or 'quit' to end the game: ";
@@ -249,17 +278,27 @@ void run_game(std::optional<Bot::Bot> bot) {
                 }
 
                 if (input.quit) {
+                    if (ponderer) { ponderer->stop(); }
                     exit_game = true;
                     break;
                 }
 
                 if (input.move.has_value()) {
                     const auto move { input.move.value() };
+                    // Checked on a copy; the move itself is played with the animation below.
+                    Cuarenta::Game_State trial { game };
+                    const auto played { Cuarenta::try_make_move(trial, move) };
                     size_t it = moves.find(move.targets_mask);
-                    if (it != moves.capacity()) {
+                    if (played && it != moves.size()) {
                         chosen = it;
                         break;
                     }
+                    if (!played) {
+                        flash_invalid_input(game, view);
+                        std::cout << "Illegal move: " << Cuarenta::move_error_message(played.error())
+                                  << ". Type 'help' to list the moves you can make.\n";
+                        continue;
+                    }
                 }
 
                 flash_invalid_input(game, view);
@@ -268,7 +307,7 @@ void run_game(std::optional<Bot::Bot> bot) {
             }
         } else if (bot.has_value()) {
             print_game_state(game, Cuarenta::mask_to_vector(game.table.cards), view);
-            chosen = choose_move_ai(game, bot.value(), 10);
+            chosen = choose_move_ai(game, bot.value(), BOT_DEPTH, ponderer ? &ponderer.value() : nullptr);
         }
 
         if (exit_game) { break; }
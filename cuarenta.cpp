@@ -1,8 +1,12 @@
 #include "cuarenta.h"
+#include "bit_kernels.h"
+#include "movegen.h"
+#include "search_state.h"
 
 #include <random>
 #include <algorithm>
 #include <optional>
+#include <string>
 #include <utility>
 #include <cassert>
 #include <limits>
@@ -28,16 +32,8 @@ void add_ranks(RankMask& cards, const RankMask to_add) {
 }
 
 int sequence_waterfall (RankMask& cards, const Rank start_card) {
-    int num_cards_sequenced { 0 };
-    Rank current_card = start_card;
-    while (current_card != Rank::King) {
-        current_card++;
-        if (contains_ranks(cards, to_mask(current_card))) { 
-            remove_ranks(cards, to_mask(current_card));
-            num_cards_sequenced++;
-        }
-        else { return num_cards_sequenced; }
-    }
+    const int num_cards_sequenced { waterfall_length(to_u16(cards), to_u16(start_card)) };
+    remove_ranks(cards, to_mask(waterfall_mask(to_u16(start_card), num_cards_sequenced)));
     return num_cards_sequenced;
 }
 
@@ -51,81 +47,92 @@ void update_captured_cards(Game_State& game) {
     }
 }
 
-Undo make_move_in_place(Game_State& game, const Move& move) {
+namespace {
+
+bool has_card(const Hand& hand, const Rank card)        { return is_card_in_hand(hand, card); }
+bool has_card(const Packed_Hand& hand, const Rank card) { return hand.contains(card); }
+
+// Everything try_make_move() rejects, checked without touching the state.
+template <class State>
+std::optional<Move_Error> validate_move(const State& game, const Move& move) {
+
+    const uint16_t move_bits { to_u16(move.targets_mask) };
+    if (move_bits == 0 || (move_bits & ~ALL_RANK_BITS) != 0) { return Move_Error::Not_A_Move; }
+
+    const uint16_t played { played_bit(move_bits) };
+    if (!has_card(current_player_state(game).hand, to_rank(played))) { return Move_Error::Card_Not_In_Hand; }
+    if (!is_addition(move_bits)) { return std::nullopt; }
+
+    const RankMask summed { to_mask(static_cast<uint16_t>(move_bits & ~played)) };
+    const auto& patterns { ADDITIONS_BY_RANK[static_cast<size_t>(rank_to_int(to_rank(played)))] };
+    if (std::ranges::find(patterns, summed) == patterns.end()) { return Move_Error::Not_An_Addition; }
+    if (!contains_ranks(game.table.cards, summed)) { return Move_Error::Cards_Not_On_Table; }
+    return std::nullopt;
+}
+
+// Game_State counterpart of make_move_unchecked().
+Undo make_move_unchecked(Game_State& game, const Move& move) {
 
     Player_State& player_state { current_player_state(game) };
     Table& table               { game.table };
-    
-    const RankMask targets_mask { move.targets_mask };
-    const bool is_addition      { !std::has_single_bit(to_u16(targets_mask)) };
+
+    const uint16_t move_bits    { to_u16(move.targets_mask) };
     const Rank played_card      { move.get_played_rank() };
 
-    Undo undo { .move = move,
-                .last_played_card = table.last_played_card,
-                .num_waterfalled_cards = 0 };
+    const Move_Effect effect { move_effect(to_u16(table.cards), to_u16(table.last_played_card), move_bits) };
 
-    const RankMask addition_mask { move.targets_mask & ~to_mask(played_card) };
-    const bool table_has_capture { (is_addition)   ? 
-        contains_ranks(table.cards, addition_mask) :
-        contains_ranks(table.cards, to_mask(played_card)) };
+    const Undo undo { .move = move,
+                      .last_played_card = table.last_played_card,
+                      .num_waterfalled_cards = effect.num_waterfalled };
 
-    if (!is_card_in_hand(player_state.hand, played_card)) {
-        player_state.hand.print_hand();
-        throw std::invalid_argument(
-            "Invalid RankMask used, played card (MSB in RankMask) is not in current players hand.\n"
-        );
-    }
+    table.cards            = to_mask(effect.table_after);
+    table.last_played_card = effect.is_capture ? Rank::Invalid : played_card;
 
-    if (is_addition) {
-        if (!table_has_capture) {
-            throw std::invalid_argument(
-            "Invalid RankMask used, cards are not on the table.\n"
-            );
-        }
-        else {
-            const int num_waterfalled_cards { 
-                sequence_waterfall(table.cards, played_card) };
-            const int num_cards_captured { 
-                std::popcount(to_u16(targets_mask)) + num_waterfalled_cards };
-            
-            player_state.num_captured_cards += num_cards_captured;
-            undo.num_waterfalled_cards += num_waterfalled_cards;
-                
-            remove_ranks(table.cards, targets_mask & ~to_mask(played_card));
-            table.last_played_card = Rank::Invalid;
-        }
-    }
+    // Caída and limpia: +2 points each
+    player_state.num_captured_cards += effect.num_captured;
+    player_state.score += 2 * (static_cast<int>(effect.is_caida) + static_cast<int>(effect.is_limpia));
 
-    else {
-        if (!table_has_capture) {
-            table.last_played_card = played_card;
-            add_ranks(table.cards, targets_mask);
-        }
-        else {
-            // Caída: +2 points
-            if (played_card == table.last_played_card) {
-                player_state.score += 2;
-            }
-            const int num_waterfalled_cards { 
-                sequence_waterfall(table.cards, played_card) };
-            const int num_cards_captured { 
-                2 + num_waterfalled_cards };
-
-            player_state.num_captured_cards += num_cards_captured;
-            undo.num_waterfalled_cards += num_waterfalled_cards;
-
-            remove_ranks(table.cards, to_mask(played_card));
-            table.last_played_card = Rank::Invalid;
-        }
+    remove_card_from_hand(player_state.hand, played_card);
+    return undo;
+}
+
+template <class State>
+std::expected<Undo, Move_Error> try_make_move_impl(State& game, const Move& move) {
+    if (const auto error { validate_move(game, move) }) { return std::unexpected(*error); }
+    return make_move_unchecked(game, move);
+}
+
+template <class State>
+Undo make_move_or_throw(State& game, const Move& move) {
+    const auto undo { try_make_move(game, move) };
+    if (!undo) {
+        throw std::invalid_argument("Invalid RankMask used, " + std::string{ move_error_message(undo.error()) } + ".\n");
     }
+    return *undo;
+}
+
+} // namespace
 
-    // Limpia: +2 points
-    if (to_u16(table.cards) == 0) {
-        player_state.score += 2;
+std::string_view move_error_message(const Move_Error error) {
+    switch (error) {
+        case Move_Error::Not_A_Move:         return "not a move";
+        case Move_Error::Card_Not_In_Hand:   return "played card (MSB in RankMask) is not in current players hand";
+        case Move_Error::Not_An_Addition:    return "cards do not add up to the played card";
+        case Move_Error::Cards_Not_On_Table: return "cards are not on the table";
     }
+    return "unknown move error";
+}
 
-    remove_card_from_hand(player_state.hand, played_card);
-    return undo;
+std::expected<Undo, Move_Error> try_make_move(Game_State& game, const Move& move) {
+    return try_make_move_impl(game, move);
+}
+
+std::expected<Undo, Move_Error> try_make_move(Search_State& state, const Move& move) {
+    return try_make_move_impl(state, move);
+}
+
+Undo make_move_in_place(Game_State& game, const Move& move) {
+    return make_move_or_throw(game, move);
 }
 
 // pre-condition: Player to_move is the person that did make_move()
@@ -133,37 +140,25 @@ void undo_move_in_place(Game_State& game, const Undo& undo) {
 
     Player_State& player_state { current_player_state(game) };
     Table& table               { game.table };
-    const Move& move           { undo.move };
-    
-    const RankMask targets_mask { move.targets_mask };
-    const bool is_addition      { !std::has_single_bit(to_u16(targets_mask)) };
-    Rank played_card            { move.get_played_rank() };
 
-    const RankMask addition_mask { move.targets_mask & ~to_mask(played_card) };
-    const bool card_on_table     { contains_ranks(table.cards, to_mask(played_card)) };
+    const Move_Effect effect { undo_effect(to_u16(table.cards), to_u16(undo.last_played_card),
+                                           to_u16(undo.move.targets_mask), undo.num_waterfalled_cards) };
 
-    player_state.hand.cards.push_back(played_card);
+    table.cards            = to_mask(effect.table_after);
     table.last_played_card = undo.last_played_card;
 
-    if ((played_card == undo.last_played_card) && !is_addition) { player_state.score -= 2; } // Caida
-    if (to_u16(table.cards) == 0)                               { player_state.score -= 2; } // Limpia
+    player_state.num_captured_cards -= effect.num_captured;
+    player_state.score -= 2 * (static_cast<int>(effect.is_caida) + static_cast<int>(effect.is_limpia));
 
-    if (is_addition) { add_ranks(table.cards, addition_mask); }
-    else {
-        if (card_on_table) { remove_ranks(table.cards, to_mask(played_card)); }
-        else               { add_ranks(table.cards, to_mask(played_card)); }
-    }
-    
-    if (!card_on_table || is_addition) {
-        int num_captured { (is_addition) ? std::popcount(to_u16(targets_mask)) : 2 };
-        player_state.num_captured_cards -= num_captured + undo.num_waterfalled_cards;
-    }
+    player_state.hand.cards.push_back(undo.move.get_played_rank());
+}
 
-    // keep last, as it modifies played_card
-    for (int i{}; i < undo.num_waterfalled_cards; i++) {
-        played_card++;
-        add_ranks(table.cards, to_mask(played_card));
-    }
+Undo make_move_in_place(Search_State& state, const Move& move) {
+    return make_move_or_throw(state, move);
+}
+
+void undo_move_in_place(Search_State& state, const Undo& undo) {
+    undo_move_unchecked(state, undo);
 }
 
-} // namespace Cuarenta
\ No newline at end of file
+} // namespace Cuarenta
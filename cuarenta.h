@@ -9,6 +9,9 @@
 #include <utility>
 #include <type_traits>
 #include <bit>
+#include <cstdint>
+#include <expected>
+#include <string_view>
 
 namespace Cuarenta {
 
@@ -18,15 +21,38 @@ struct Undo {
     int num_waterfalled_cards{};
 };
 
+struct Search_State; // search_state.h
+
 static constexpr int NUM_CARDS {40};
 static constexpr int NUM_CARDS_PER_RANK { NUM_CARDS / NUM_RANKS };
 
 Deck make_cuarenta_deck();
 Hand generate_hand(Deck& d);
 
+// Why try_make_move() rejected a move.
+enum class Move_Error : uint8_t {
+    Not_A_Move,         // no bits, or bits outside the ten ranks
+    Card_Not_In_Hand,   // played card (highest bit) is not in the mover's hand
+    Not_An_Addition,    // the lower bits do not sum to the played rank
+    Cards_Not_On_Table, // an addition's cards are not all on the table
+};
+
+std::string_view move_error_message(Move_Error error);
+
+// Checked moves, for input that did not come from generate_all_moves() (the
+// CLI, saved games). The state is left untouched when the move is rejected.
+std::expected<Undo, Move_Error> try_make_move(Game_State& game, const Move& move);
+std::expected<Undo, Move_Error> try_make_move(Search_State& state, const Move& move);
+
+// As try_make_move(), but throws std::invalid_argument on an illegal move.
 Undo make_move_in_place(Game_State& game, const Move& move);
 void undo_move_in_place(Game_State& game, const Undo& undo);
 
+// Same rules on the packed search representation; no heap traffic. The search
+// uses make_move_unchecked() (search_state.h) instead.
+Undo make_move_in_place(Search_State& state, const Move& move);
+void undo_move_in_place(Search_State& state, const Undo& undo);
+
 void update_captured_cards(Game_State& game_state);
 
 void remove_ranks(RankMask& cards, const RankMask to_remove);
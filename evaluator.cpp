@@ -0,0 +1,101 @@
+#include "evaluator.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace Bot {
+
+namespace {
+
+constexpr const char* MAGIC { "cuarenta-eval" };
+constexpr int FORMAT_VERSION { 1 };
+
+// Reads count whitespace-separated integers into out.
+template <class Range>
+void read_values(std::istream& in, Range& out, const std::string& path) {
+    for (auto& value : out) {
+        if (!(in >> value)) { throw std::runtime_error("Truncated evaluator file " + path + "\n"); }
+    }
+}
+
+void expect_section(std::istream& in, const std::string& name, const size_t size, const std::string& path) {
+    std::string word;
+    size_t actual {};
+    if (!(in >> word >> actual) || word != name || actual != size) {
+        throw std::runtime_error("Expected section '" + name + " " + std::to_string(size) + "' in " + path + "\n");
+    }
+}
+
+} // namespace
+
+const Evaluator& default_evaluator() {
+    static const ScoreDifferenceEvaluator evaluator{};
+    return evaluator;
+}
+
+TableEvaluator::TableEvaluator() {
+    for (size_t own{}; own <= MAX_CAPTURED; own++) {
+        for (size_t opp{}; opp <= MAX_CAPTURED; opp++) {
+            captured_[own][opp] = FIXED_POINT_ONE * (captured_cards_bonus(static_cast<int>(own)) -
+                                                     captured_cards_bonus(static_cast<int>(opp)));
+        }
+    }
+    update_id();
+}
+
+void TableEvaluator::update_id() {
+    // FNV-1a over every entry; 0 is reserved for ScoreDifferenceEvaluator.
+    uint32_t hash { 2166136261u };
+    auto mix = [&hash](const int32_t value) {
+        for (int byte{}; byte < 4; byte++) {
+            hash ^= (static_cast<uint32_t>(value) >> (8 * byte)) & 0xFFu;
+            hash *= 16777619u;
+        }
+    };
+    for (const auto& row : captured_) { for (const int32_t value : row) { mix(value); } }
+    for (const int32_t value : table_) { mix(value); }
+    id_ = (hash == ScoreDifferenceEvaluator::ID) ? 1 : hash;
+}
+
+TableEvaluator TableEvaluator::load(const std::string& path) {
+    std::ifstream in { path };
+    if (!in) { throw std::runtime_error("Could not open evaluator file " + path + "\n"); }
+
+    std::string magic;
+    int version {};
+    int32_t scale {};
+    std::string scale_word;
+    if (!(in >> magic >> version >> scale_word >> scale) || magic != MAGIC || scale_word != "scale") {
+        throw std::runtime_error(path + " is not an evaluator file.\n");
+    }
+    if (version != FORMAT_VERSION || scale != FIXED_POINT_ONE) {
+        throw std::runtime_error("Unsupported evaluator file version or scale in " + path + "\n");
+    }
+
+    TableEvaluator evaluator{};
+    expect_section(in, "captured", (MAX_CAPTURED + 1) * (MAX_CAPTURED + 1), path);
+    for (auto& row : evaluator.captured_) { read_values(in, row, path); }
+    expect_section(in, "table", NUM_TABLES, path);
+    read_values(in, evaluator.table_, path);
+
+    evaluator.update_id();
+    return evaluator;
+}
+
+void TableEvaluator::save(const std::string& path) const {
+    std::ofstream out { path };
+    if (!out) { throw std::runtime_error("Could not open " + path + " for writing.\n"); }
+
+    out << MAGIC << ' ' << FORMAT_VERSION << "\nscale " << FIXED_POINT_ONE << '\n';
+    out << "captured " << (MAX_CAPTURED + 1) * (MAX_CAPTURED + 1) << '\n';
+    for (const auto& row : captured_) {
+        for (size_t i{}; i < row.size(); i++) { out << row[i] << ((i + 1 < row.size()) ? ' ' : '\n'); }
+    }
+    out << "table " << NUM_TABLES << '\n';
+    for (size_t mask{}; mask < NUM_TABLES; mask++) {
+        out << table_[mask] << ((mask % 32 == 31) ? '\n' : ' ');
+    }
+    if (!out) { throw std::runtime_error("Failed writing " + path + "\n"); }
+}
+
+} // namespace Bot
@@ -0,0 +1,96 @@
+#pragma once
+#include "cuarenta.h"
+#include "rank.h"
+#include "search_state.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Bot {
+
+// Value of a search leaf for the player to move, in points. Called at every
+// horizon and end-of-deal node, so implementations should be a few lookups.
+class Evaluator {
+public:
+    virtual ~Evaluator() = default;
+    virtual double evaluate(const Cuarenta::Search_State& state) const = 0;
+
+    // Identifies the leaf values; tablebases are only probed by an evaluator
+    // with the id they were solved against.
+    virtual uint32_t id() const = 0;
+};
+
+// Score difference plus the 20-card bonus, as if the round ended now.
+constexpr int captured_cards_bonus(const int num_captured_cards) {
+    // Scoring rules: 20 cards = 6pts, 22 cards = 8pts, etc.
+    return (num_captured_cards >= 20) ? 6 + 2 * ((num_captured_cards - 20) / 2) : 0;
+}
+
+constexpr double heuristic_value(const Cuarenta::Search_State& game_state) {
+    const auto& player { Cuarenta::current_player_state(game_state) };
+    const auto& enemy  { Cuarenta::opposing_player_state(game_state) };
+    return player.score - enemy.score
+         + captured_cards_bonus(player.num_captured_cards) - captured_cards_bonus(enemy.num_captured_cards);
+}
+
+class ScoreDifferenceEvaluator final : public Evaluator {
+public:
+    static constexpr uint32_t ID { 0 };
+    double evaluate(const Cuarenta::Search_State& state) const override { return heuristic_value(state); }
+    uint32_t id() const override { return ID; }
+};
+
+static constexpr const char* DEFAULT_EVALUATOR_PATH { "cuarenta_eval.txt" };
+
+// Shared ScoreDifferenceEvaluator, used when a bot has no evaluator set.
+const Evaluator& default_evaluator();
+
+// Score difference plus two learned terms in fixed point:
+//   captured[own captured][opponent captured]  expected points still to come
+//                                              from the card race, 20-card
+//                                              bonus included
+//   table[table mask]                          what the cards left on the
+//                                              table are worth to the mover
+// The defaults reproduce heuristic_value() exactly. Tables are fitted from
+// self-play and stored as text, see load() and save().
+class TableEvaluator final : public Evaluator {
+public:
+    static constexpr int32_t FIXED_POINT_ONE { 256 }; // 1 point
+    static constexpr size_t MAX_CAPTURED { 40 };
+    static constexpr size_t NUM_TABLES { size_t{1} << Cuarenta::NUM_RANKS };
+
+    using CapturedTable = std::array<std::array<int32_t, MAX_CAPTURED + 1>, MAX_CAPTURED + 1>;
+    using TableTable    = std::array<int32_t, NUM_TABLES>;
+
+    TableEvaluator();
+
+    // Throws std::runtime_error on a missing or malformed file.
+    static TableEvaluator load(const std::string& path);
+    void save(const std::string& path) const;
+
+    double evaluate(const Cuarenta::Search_State& state) const override {
+        const auto& player { Cuarenta::current_player_state(state) };
+        const auto& enemy  { Cuarenta::opposing_player_state(state) };
+        const int32_t learned { captured_[player.num_captured_cards][enemy.num_captured_cards]
+                              + table_[Cuarenta::to_u16(state.table.cards)] };
+        return player.score - enemy.score + static_cast<double>(learned) / FIXED_POINT_ONE;
+    }
+    uint32_t id() const override { return id_; }
+
+    CapturedTable& captured() { return captured_; }
+    TableTable& table() { return table_; }
+    const CapturedTable& captured() const { return captured_; }
+    const TableTable& table() const { return table_; }
+
+    // Recomputes id() from the contents; call after editing the tables.
+    void update_id();
+
+private:
+    CapturedTable captured_{};
+    TableTable table_{};
+    uint32_t id_{};
+};
+
+} // namespace Bot
@@ -48,6 +48,11 @@ struct Deck {
         }
     }
 
+    // Shuffled with the caller's generator, for reproducible deals.
+    explicit Deck(std::mt19937& gen) : Deck{false} {
+        std::shuffle(cards.begin(), cards.end(), gen);
+    }
+
     Hand draw_hand() {
         if (cards.size() < 5) {
             throw std::runtime_error("Error: deck too small");
@@ -124,6 +129,18 @@ struct Game_State {
                           .score = 0 } }},
         to_move{ Player::P1 } {}
 
+    explicit Game_State(std::mt19937& gen) 
+        : table{},
+          deck{gen},
+          players{{
+            Player_State{ .hand = deck.draw_hand(),
+                          .num_captured_cards = 0,
+                          .score = 0 },
+            Player_State{ .hand = deck.draw_hand(),
+                          .num_captured_cards = 0,
+                          .score = 0 } }},
+        to_move{ Player::P1 } {}
+
     Game_State(Hand handp1, Hand handp2)
         : table{},
           deck{true},
@@ -0,0 +1,128 @@
+#include "hand_sampler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Bot {
+
+HandSampler::HandSampler(const RankProbabilities& probs) {
+
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        counts_[i]  = probs[i].count;
+        weights_[i] = probs[i].probability_weight;
+        if (counts_[i] < 0 || weights_[i] < 0.0) {
+            throw std::invalid_argument("Hand sampler counts and weights must be non-negative.\n");
+        }
+        mass_[i] = counts_[i] * weights_[i];
+        total_mass_ += mass_[i];
+        num_cards_  += counts_[i];
+    }
+}
+
+template <class Rng>
+Cuarenta::Packed_Hand HandSampler::sample(const int hand_size, Rng& gen) const {
+
+    if (hand_size > num_cards_) {
+        throw std::invalid_argument("Cannot deal more cards than remain unseen.\n");
+    }
+
+    auto counts  { counts_ };
+    auto mass    { mass_ };
+    double total { total_mass_ };
+    Cuarenta::Packed_Hand hand{};
+
+    for (int card{}; card < hand_size; card++) {
+
+        // Rounding can leave the scan a hair short of the end; the last rank
+        // with mass left is the one the draw belongs to.
+        std::uniform_real_distribution<double> dis(0.0, total);
+        double rand { dis(gen) };
+        size_t drawn {};
+
+        for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+            if (mass[i] <= 0.0) { continue; }
+            drawn = i;
+            rand -= mass[i];
+            if (rand < 0.0) { break; }
+        }
+        if (drawn == 0) {
+            throw std::runtime_error("Hand sampler has no weighted cards left.\n");
+        }
+
+        hand.add(Cuarenta::int_to_rank(static_cast<int>(drawn)));
+        counts[drawn]--;
+        mass[drawn] = counts[drawn] * weights_[drawn];
+
+        // Summed afresh rather than decremented, so rounding cannot drift.
+        total = 0.0;
+        for (const double m : mass) { total += m; }
+    }
+    return hand;
+}
+
+template Cuarenta::Packed_Hand HandSampler::sample(const int, std::mt19937&) const;
+template Cuarenta::Packed_Hand HandSampler::sample(const int, SampleRng&) const;
+
+double HandSampler::probability(const Cuarenta::Packed_Hand& hand) const {
+
+    std::vector<size_t> ranks;
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        const int held { hand.count(Cuarenta::int_to_rank(static_cast<int>(i))) };
+        if (held > counts_[i] || (held > 0 && mass_[i] <= 0.0)) { return 0.0; }
+        ranks.insert(ranks.end(), static_cast<size_t>(held), i);
+    }
+
+    // At most 5! orderings, fewer with repeated ranks.
+    double total_probability {};
+    do {
+        auto counts  { counts_ };
+        double total { total_mass_ };
+        double p     { 1.0 };
+        for (const size_t i : ranks) {
+            p *= counts[i] * weights_[i] / total;
+            counts[i]--;
+            total = 0.0;
+            for (size_t r{1}; r <= Cuarenta::NUM_RANKS; r++) { total += counts[r] * weights_[r]; }
+        }
+        total_probability += p;
+    } while (std::ranges::next_permutation(ranks).found);
+
+    return total_probability;
+}
+
+std::vector<HandSampler::World> HandSampler::enumerate(const int hand_size, const size_t max_worlds) const {
+
+    std::vector<World> worlds;
+    if (hand_size > num_cards_) { return worlds; }
+
+    bool too_many { false };
+    Cuarenta::Packed_Hand hand{};
+
+    // Chooses how many of rank i the hand holds, then recurses on the next rank.
+    auto recurse = [&](auto& self, const size_t i, const int cards_left) -> void {
+        if (too_many) { return; }
+        if (cards_left == 0) {
+            if (worlds.size() == max_worlds) { too_many = true; return; }
+            worlds.push_back(World{ .hand = hand, .probability = probability(hand) });
+            return;
+        }
+        if (i > Cuarenta::NUM_RANKS) { return; }
+
+        self(self, i + 1, cards_left);
+        if (mass_[i] <= 0.0) { return; }
+
+        const auto rank { Cuarenta::int_to_rank(static_cast<int>(i)) };
+        int taken {};
+        for (; taken < std::min(counts_[i], cards_left); taken++) {
+            hand.add(rank);
+            self(self, i + 1, cards_left - taken - 1);
+        }
+        for (; taken > 0; taken--) { hand.remove(rank); }
+    };
+    recurse(recurse, 1, hand_size);
+
+    if (too_many) { worlds.clear(); }
+    return worlds;
+}
+
+} // namespace Bot
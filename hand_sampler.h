@@ -0,0 +1,78 @@
+#pragma once
+
+#include "cuarenta.h"
+#include "inference.h"
+#include "rank.h"
+#include "search_state.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace Bot {
+
+// splitmix64 stream for dealing a single sample: seeding is one store, where
+// std::mt19937 fills and twists 624 words before its first output.
+class SampleRng {
+public:
+    using result_type = uint64_t;
+
+    explicit constexpr SampleRng(const uint64_t seed) : state_{seed} {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    constexpr result_type operator()() {
+        state_ += 0x9e3779b97f4a7c15ULL;
+        uint64_t z { state_ };
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t state_;
+};
+
+// Deals opponent hands from the unseen cards, without replacement. Every
+// unseen card of rank r carries weight probability_weight(r), so each draw
+// picks rank r with probability count(r) * weight(r) / total over the cards
+// still left, and a rank is never dealt more times than it has cards left.
+// The per-rank masses are built once, when the bot's counts change; a hand
+// only copies them.
+class HandSampler {
+public:
+    struct World {
+        Cuarenta::Packed_Hand hand;
+        double probability;
+    };
+
+    explicit HandSampler(const RankProbabilities& probs);
+
+    // Instantiated for std::mt19937 and SampleRng.
+    template <class Rng>
+    Cuarenta::Packed_Hand sample(const int hand_size, Rng& gen) const;
+
+    // Chance that sample(hand.size()) deals exactly this multiset: the sum
+    // over its distinct orderings of the sequential draw probabilities.
+    double probability(const Cuarenta::Packed_Hand& hand) const;
+
+    // Every hand of hand_size that sample() can deal, with its probability.
+    // Returns nothing once there are more than max_worlds of them.
+    std::vector<World> enumerate(const int hand_size, const size_t max_worlds) const;
+
+    int num_cards() const { return num_cards_; }
+
+private:
+    // Indexed by rank_to_int(rank), like RankProbabilities.
+    std::array<int, Cuarenta::NUM_RANKS + 1> counts_{};
+    std::array<double, Cuarenta::NUM_RANKS + 1> weights_{};
+    std::array<double, Cuarenta::NUM_RANKS + 1> mass_{}; // counts_[i] * weights_[i]
+    double total_mass_{};
+    int num_cards_{};
+};
+
+} // namespace Bot
@@ -0,0 +1,71 @@
+#include "inference.h"
+
+#include "movegen.h"
+#include "search_state.h"
+
+#include <bit>
+
+namespace Bot {
+
+Cuarenta::RankMask limpia_ranks(const Cuarenta::Table& table) {
+
+    uint16_t ranks {};
+    if (Cuarenta::to_u16(table.cards) == 0) { return Cuarenta::to_mask(ranks); }
+
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        const auto rank { Cuarenta::int_to_rank(static_cast<int>(i)) };
+
+        Cuarenta::Search_State state{};
+        state.table = table;
+        Cuarenta::current_player_state(state).hand.add(rank);
+
+        const auto moves { Cuarenta::generate_all_moves(state) };
+        for (size_t m{}; m < moves.size(); m++) {
+            const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(state, Cuarenta::Move{ moves.at(m) }) };
+            const bool cleared { Cuarenta::to_u16(state.table.cards) == 0 };
+            Cuarenta::undo_move_unchecked(state, undo);
+            if (cleared) {
+                ranks = static_cast<uint16_t>(ranks | Cuarenta::to_u16(rank));
+                break;
+            }
+        }
+    }
+    return Cuarenta::to_mask(ranks);
+}
+
+void observe_opponent_move(RankProbabilities& probs, const Cuarenta::Table& table_before,
+                           const Cuarenta::Move& move) {
+
+    const Cuarenta::Rank played_card { move.get_played_rank() };
+    const bool is_addition { !std::has_single_bit(Cuarenta::to_u16(move.targets_mask)) };
+    const Cuarenta::Rank caida_card { table_before.last_played_card };
+    const bool took_caida { !is_addition && played_card == caida_card };
+
+    if (caida_card != Cuarenta::Rank::Invalid && !took_caida) {
+        probs[static_cast<size_t>(Cuarenta::rank_to_int(caida_card))].probability_weight *= MISSED_CAIDA_LIKELIHOOD;
+    }
+    // A caida scores as much as a limpia, so taking one hides nothing.
+    if (took_caida) { return; }
+
+    Cuarenta::Search_State after{};
+    after.table = table_before;
+    Cuarenta::current_player_state(after).hand.add(played_card);
+    Cuarenta::make_move_unchecked(after, move);
+    if (Cuarenta::to_u16(after.table.cards) == 0) { return; }
+
+    // The played rank is excluded: choosing a different move with it says
+    // nothing about whether another copy is still held.
+    uint16_t missed { Cuarenta::to_u16(limpia_ranks(table_before)) };
+    missed = static_cast<uint16_t>(missed & ~Cuarenta::to_u16(played_card));
+    while (missed) {
+        const auto rank { Cuarenta::to_rank(static_cast<uint16_t>(missed & -missed)) };
+        missed &= static_cast<uint16_t>(missed - 1);
+        probs[static_cast<size_t>(Cuarenta::rank_to_int(rank))].probability_weight *= MISSED_LIMPIA_LIKELIHOOD;
+    }
+}
+
+void reset_weights(RankProbabilities& probs) {
+    for (RankProbability& prob : probs) { prob.probability_weight = 1.0; }
+}
+
+} // namespace Bot
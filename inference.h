@@ -0,0 +1,44 @@
+#pragma once
+
+#include "cuarenta.h"
+#include "game_state.h"
+#include "rank.h"
+
+#include <array>
+
+namespace Bot {
+
+struct RankProbability {
+    double probability_weight { 1.0 };
+    int count { 4 };
+};
+
+// Indexed by rank_to_int(rank); slot 0 has no rank and holds no cards.
+using RankProbabilities = std::array<RankProbability, Cuarenta::NUM_RANKS + 1>;
+
+constexpr RankProbabilities full_deck_probabilities() {
+    RankProbabilities probs{};
+    probs[0].count = 0;
+    return probs;
+}
+
+// Likelihood of the opponent passing up the play while holding the rank,
+// relative to not holding it. A caida is almost always taken; a limpia is
+// sometimes worth skipping for a bigger capture.
+static constexpr double MISSED_CAIDA_LIKELIHOOD  { 0.2 };
+static constexpr double MISSED_LIMPIA_LIKELIHOOD { 0.5 };
+
+// Ranks with at least one move that leaves this table empty.
+Cuarenta::RankMask limpia_ranks(const Cuarenta::Table& table);
+
+// Bayesian update after the opponent played move on table_before: every rank
+// that would have scored a caida or limpia the opponent passed up has its
+// weight scaled by the likelihood above. A move that scores itself is not
+// evidence against the other scoring plays. Counts are not touched.
+void observe_opponent_move(RankProbabilities& probs, const Cuarenta::Table& table_before,
+                           const Cuarenta::Move& move);
+
+// Evidence only describes the opponent's current hand; counts are kept.
+void reset_weights(RankProbabilities& probs);
+
+} // namespace Bot
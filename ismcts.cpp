@@ -0,0 +1,142 @@
+#include "ismcts.h"
+
+#include "move_ordering.h"
+#include "movegen.h"
+#include "sample_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Bot {
+
+IsmctsTree::IsmctsTree(const Cuarenta::Search_State& root, const HandSampler& sampler,
+                       const Evaluator& evaluator, const int depth)
+    : root_{ root },
+      sampler_{ sampler },
+      evaluator_{ evaluator },
+      depth_{ depth },
+      opp_hand_size_{ Cuarenta::opposing_player_state(root).hand.size() },
+      nodes_(1) {}
+
+bool IsmctsTree::is_leaf(const Cuarenta::Search_State& state, const int ply) const {
+    return Cuarenta::opposing_player_state(state).score >= 40 ||
+           Cuarenta::current_player_state(state).hand.empty() ||
+           ply >= depth_;
+}
+
+// Same leaf values as negamax, clamped like PIMC samples, turned to the root
+// player's side.
+double IsmctsTree::root_value(const Cuarenta::Search_State& state) const {
+    const double value { (Cuarenta::opposing_player_state(state).score >= 40)
+        ? -DECIDED_GAME_VALUE
+        : std::clamp(evaluator_.evaluate(state), -DECIDED_GAME_VALUE, DECIDED_GAME_VALUE) };
+    return (state.to_move == root_.to_move) ? value : -value;
+}
+
+// Finishes the deal mostly greedily: captures, caidas and limpias first, as
+// MoveOrdering ranks them, with random moves mixed in.
+double IsmctsTree::playout(Cuarenta::Search_State& state, int ply, std::mt19937& gen) const {
+    std::bernoulli_distribution greedy { GREEDY_SHARE };
+    for (; !is_leaf(state, ply); ply++) {
+        const auto moves { Cuarenta::generate_all_moves(state) };
+        size_t chosen {};
+        if (greedy(gen)) {
+            int best_score { std::numeric_limits<int>::lowest() };
+            for (size_t i{}; i < moves.size(); i++) {
+                const int score { MoveOrdering::static_score(state, moves.at(i)) };
+                if (score > best_score) { best_score = score; chosen = i; }
+            }
+        } else {
+            chosen = std::uniform_int_distribution<size_t>{ 0, moves.size() - 1 }(gen);
+        }
+        Cuarenta::make_move_unchecked(state, Cuarenta::Move{ moves.at(chosen) });
+        state.advance_turn();
+    }
+    return root_value(state);
+}
+
+uint32_t IsmctsTree::add_child(const uint32_t parent, const Cuarenta::RankMask move) {
+    const auto index { static_cast<uint32_t>(nodes_.size()) };
+    nodes_.push_back(Node{ .move = move, .first_child = NONE, .next_sibling = nodes_[parent].first_child,
+                           .visits = 0, .availability = 1, .reward = 0.0, .reward_sq = 0.0 });
+    nodes_[parent].first_child = index;
+    return index;
+}
+
+void IsmctsTree::iterate(std::mt19937& gen) {
+
+    Cuarenta::Search_State state { root_ };
+    Cuarenta::opposing_player_state(state).hand = sampler_.sample(opp_hand_size_, gen);
+
+    path_.assign(1, 0);
+    uint32_t node {};
+    int ply {};
+
+    // Selection and expansion, over the moves legal in this deal only.
+    while (!is_leaf(state, ply)) {
+        const auto moves { Cuarenta::generate_all_moves(state) };
+
+        uint32_t selected { NONE };
+        double best_ucb { std::numeric_limits<double>::lowest() };
+        util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE> untried{};
+
+        for (size_t i{}; i < moves.size(); i++) {
+            uint32_t child { nodes_[node].first_child };
+            while (child != NONE && nodes_[child].move != moves.at(i)) { child = nodes_[child].next_sibling; }
+            if (child == NONE) { untried.push_back(moves.at(i)); continue; }
+
+            Node& c { nodes_[child] };
+            c.availability++;
+            const double ucb { c.reward / c.visits +
+                EXPLORATION * std::sqrt(std::log(static_cast<double>(c.availability)) / c.visits) };
+            if (ucb > best_ucb) { best_ucb = ucb; selected = child; }
+        }
+
+        const bool expand { !untried.empty() };
+        if (expand) {
+            const auto move { untried.at(std::uniform_int_distribution<size_t>{ 0, untried.size() - 1 }(gen)) };
+            selected = add_child(node, move); // may reallocate nodes_
+        }
+
+        Cuarenta::make_move_unchecked(state, Cuarenta::Move{ nodes_[selected].move });
+        state.advance_turn();
+        ply++;
+        node = selected;
+        path_.push_back(node);
+        if (expand) { break; }
+    }
+
+    const double value { playout(state, ply, gen) };
+
+    // Children of the root are the root player's moves, then sides alternate.
+    nodes_.front().visits++;
+    for (size_t i{1}; i < path_.size(); i++) {
+        const double reward { (i % 2 == 1) ? value : -value };
+        Node& n { nodes_[path_[i]] };
+        n.visits++;
+        n.reward    += reward;
+        n.reward_sq += reward * reward;
+    }
+}
+
+std::vector<IsmctsTree::RootStats> IsmctsTree::root_stats() const {
+    const auto moves { Cuarenta::generate_all_moves(root_) };
+    std::vector<RootStats> stats;
+    stats.reserve(moves.size());
+
+    for (size_t i{}; i < moves.size(); i++) {
+        RootStats s { .move = moves.at(i), .visits = 0, .mean = 0.0, .std_dev = 0.0 };
+        for (uint32_t child { nodes_.front().first_child }; child != NONE; child = nodes_[child].next_sibling) {
+            const Node& c { nodes_[child] };
+            if (c.move != s.move || c.visits == 0) { continue; }
+            s.visits  = c.visits;
+            s.mean    = c.reward / c.visits;
+            s.std_dev = std::sqrt(std::max(0.0, c.reward_sq / c.visits - s.mean * s.mean));
+        }
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+} // namespace Bot
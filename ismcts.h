@@ -0,0 +1,75 @@
+#pragma once
+#include "cuarenta.h"
+#include "dynamic_array.h"
+#include "evaluator.h"
+#include "hand_sampler.h"
+#include "rank.h"
+#include "search_state.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace Bot {
+
+// Single-observer information-set MCTS. One tree is grown from the bot's own
+// information set: every iteration deals the opponent a fresh hand, descends
+// through the moves legal in that deal, adds one node and finishes the deal
+// with a playout. Opponent nodes are shared across deals, so the bot cannot
+// choose differently per hidden hand the way a PIMC sample does (strategy
+// fusion). Selection is UCB1 over availability counts: a child's
+// exploration term only counts iterations in which its move was legal.
+class IsmctsTree {
+public:
+    static constexpr double EXPLORATION  { 3.0 };  // UCB1 constant, in points
+    static constexpr double GREEDY_SHARE { 0.75 }; // playout moves taken by MoveOrdering score
+
+    struct RootStats {
+        Cuarenta::RankMask move;
+        uint32_t visits;
+        double mean;     // points for the root player
+        double std_dev;
+    };
+
+    // Values are in points for the player to move at root, from `evaluator`
+    // at the end of the deal or `depth` plies down, like negamax.
+    IsmctsTree(const Cuarenta::Search_State& root, const HandSampler& sampler,
+               const Evaluator& evaluator, const int depth);
+
+    void iterate(std::mt19937& gen);
+
+    // One entry per root move, in generate_all_moves order.
+    std::vector<RootStats> root_stats() const;
+    uint64_t num_iterations() const { return nodes_.front().visits; }
+    size_t num_nodes() const { return nodes_.size(); }
+
+private:
+    static constexpr uint32_t NONE { UINT32_MAX };
+
+    // reward and reward_sq are from the side of the player who made `move`.
+    struct Node {
+        Cuarenta::RankMask move{};
+        uint32_t first_child{ NONE };
+        uint32_t next_sibling{ NONE };
+        uint32_t visits{};
+        uint32_t availability{};
+        double reward{};
+        double reward_sq{};
+    };
+
+    bool is_leaf(const Cuarenta::Search_State& state, const int ply) const;
+    double root_value(const Cuarenta::Search_State& state) const;
+    double playout(Cuarenta::Search_State& state, int ply, std::mt19937& gen) const;
+    uint32_t add_child(const uint32_t parent, const Cuarenta::RankMask move);
+
+    Cuarenta::Search_State root_;
+    const HandSampler& sampler_;
+    const Evaluator& evaluator_;
+    int depth_;
+    int opp_hand_size_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> path_; // reused by iterate()
+};
+
+} // namespace Bot
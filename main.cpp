@@ -3,9 +3,14 @@
 #include "cuarenta.h"
 #include "timer.h"
 #include "movegen.h"
+#include "tablebase.h"
+#include "evaluator.h"
 
 #include <assert.h>
 #include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -23,6 +28,19 @@ struct Data {
 
 int main() {
     
+    // Probed by every search when present; see cuarenta_tbgen.
+    std::optional<Bot::Tablebase> tablebase{};
+    if (std::filesystem::exists(Bot::DEFAULT_TABLEBASE_PATH)) {
+        tablebase = Bot::Tablebase::load(Bot::DEFAULT_TABLEBASE_PATH);
+        Bot::set_active_tablebase(&tablebase.value());
+    }
+
+    // Learned leaf values when present; otherwise the score difference.
+    std::shared_ptr<const Bot::Evaluator> evaluator{};
+    if (std::filesystem::exists(Bot::DEFAULT_EVALUATOR_PATH)) {
+        evaluator = std::make_shared<const Bot::TableEvaluator>(Bot::TableEvaluator::load(Bot::DEFAULT_EVALUATOR_PATH));
+    }
+
     int num_iter { 20 };
     std::vector<Data> data {};
 
@@ -31,6 +49,10 @@ int main() {
 
         Bot::Bot botp1 {100};
         Bot::Bot botp2 {100};
+        botp1.evaluator_ = evaluator;
+        botp2.evaluator_ = evaluator;
+        botp1.context_ = std::make_shared<Bot::SearchContext>();
+        botp2.context_ = std::make_shared<Bot::SearchContext>();
         Cuarenta::Game_State game{};
 
         data.push_back( Data{.player = Cuarenta::Player::P1, .is_updated = false} );
@@ -98,8 +120,9 @@ int main() {
             }
 
             auto move { Bot::choose_best_move(current_bot, game, 10) };
+            const Cuarenta::Table table_before { game.table };
             Cuarenta::make_move_in_place(game, move);
-            opposing_bot.update_from_move(move);
+            opposing_bot.update_from_move(move, table_before);
             game.advance_turn();
         }
     }
@@ -0,0 +1,82 @@
+#include "move_ordering.h"
+
+#include "bit_kernels.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Bot {
+
+namespace {
+
+constexpr int CAIDA_SCORE      { 1 << 22 };
+constexpr int LIMPIA_SCORE     { 1 << 21 };
+constexpr int WATERFALL_SCORE  { 1 << 17 }; // per waterfalled card, at most 9
+constexpr int CAPTURE_SCORE    { 1 << 16 };
+constexpr int KILLER_SCORE     { 1 << 14 }; // first killer; the second gets half
+
+} // namespace
+
+int MoveOrdering::static_score(const Cuarenta::Search_State& state, const Cuarenta::RankMask move) {
+
+    const Cuarenta::Move_Effect effect { Cuarenta::move_effect(Cuarenta::to_u16(state.table.cards),
+                                                              Cuarenta::to_u16(state.table.last_played_card),
+                                                              Cuarenta::to_u16(move)) };
+    if (!effect.is_capture) { return 0; } // drop
+
+    return CAPTURE_SCORE
+         + (effect.is_caida ? CAIDA_SCORE : 0)
+         + (effect.is_limpia ? LIMPIA_SCORE : 0)
+         + effect.num_waterfalled * WATERFALL_SCORE;
+}
+
+void MoveOrdering::order(const Cuarenta::Search_State& state,
+                         util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE>& moves,
+                         const int depth) const {
+
+    const size_t level { static_cast<size_t>(std::clamp(depth, 0, MAX_DEPTH)) };
+    std::array<int, Cuarenta::MAX_MOVES_PER_TABLE> scores{};
+
+    for (size_t i{}; i < moves.size(); i++) {
+        const Cuarenta::RankMask move { moves.at(i) };
+        int score { static_score(state, move) + static_cast<int>(history_[Cuarenta::to_u16(move)]) };
+        if (move == killers_[level][0])      { score += KILLER_SCORE; }
+        else if (move == killers_[level][1]) { score += KILLER_SCORE / 2; }
+        scores[i] = score;
+    }
+
+    // Insertion sort: at most 16 moves, and stable so ties keep generator order.
+    for (size_t i{1}; i < moves.size(); i++) {
+        const Cuarenta::RankMask move { moves.at(i) };
+        const int score { scores[i] };
+        size_t j { i };
+        for (; j > 0 && scores[j - 1] < score; j--) {
+            scores[j] = scores[j - 1];
+            moves.at(j) = moves.at(j - 1);
+        }
+        scores[j] = score;
+        moves.at(j) = move;
+    }
+}
+
+void MoveOrdering::record_cutoff(const Cuarenta::RankMask move, const int depth) {
+
+    const size_t level { static_cast<size_t>(std::clamp(depth, 0, MAX_DEPTH)) };
+    if (killers_[level][0] != move) {
+        killers_[level][1] = killers_[level][0];
+        killers_[level][0] = move;
+    }
+
+    uint32_t& history { history_[Cuarenta::to_u16(move)] };
+    history += static_cast<uint32_t>(depth * depth);
+    if (history > MAX_HISTORY) {
+        for (uint32_t& h : history_) { h /= 2; } // age every entry, keeping relative order
+    }
+}
+
+void MoveOrdering::clear() {
+    killers_ = {};
+    history_.fill(0);
+}
+
+} // namespace Bot
@@ -0,0 +1,59 @@
+#pragma once
+#include "cuarenta.h"
+#include "dynamic_array.h"
+#include "rank.h"
+#include "search_state.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Bot {
+
+// Counters filled in by negamax when a SearchWorker is passed in.
+struct SearchStats {
+    uint64_t nodes{};              // negamax calls
+    uint64_t cutoffs{};            // beta cutoffs
+    uint64_t first_move_cutoffs{}; // cutoffs on the first move tried
+
+    void merge(const SearchStats& other) {
+        nodes              += other.nodes;
+        cutoffs            += other.cutoffs;
+        first_move_cutoffs += other.first_move_cutoffs;
+    }
+};
+
+// Orders moves so alpha-beta sees likely refutations first. Static scores,
+// strongest first: caidas, limpias, longer waterfalls, then captures before
+// drops. Ties are broken by two killer moves per depth and a history table
+// of moves that caused cutoffs, both kept across PIMC samples.
+class MoveOrdering {
+public:
+    static constexpr int MAX_DEPTH { 16 };
+
+    void order(const Cuarenta::Search_State& state,
+               util::dynamic_array<Cuarenta::RankMask, Cuarenta::MAX_MOVES_PER_TABLE>& moves,
+               const int depth) const;
+
+    void record_cutoff(const Cuarenta::RankMask move, const int depth);
+
+    void clear();
+
+    // Static part of the score; no make/undo needed.
+    static int static_score(const Cuarenta::Search_State& state, const Cuarenta::RankMask move);
+
+private:
+    static constexpr uint32_t MAX_HISTORY { (1u << 12) - 1 };
+
+    std::array<std::array<Cuarenta::RankMask, 2>, MAX_DEPTH + 1> killers_{};
+    std::array<uint32_t, 1u << Cuarenta::NUM_RANKS> history_{}; // indexed by the move's targets mask
+};
+
+// Per-thread search state that lives across the samples of one decision.
+struct SearchWorker {
+    MoveOrdering ordering{};
+    SearchStats stats{};
+    bool order_moves{ true }; // false keeps generator order, for comparisons
+};
+
+} // namespace Bot
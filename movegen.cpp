@@ -2,37 +2,93 @@
 #include "dynamic_array.h"
 #include "rank.h"
 #include "cuarenta.h"
+#include "search_state.h"
 
+#include <cstdint>
 #include <vector>
 #include <cassert>
 
 namespace Cuarenta {
 
-util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves(const Game_State& game) {   
+util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves(const Search_State& state) {
 
     util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> available_moves{};
 
-    const RankMask low_table_mask { game.table.cards & LOW_MASK };
+    const uint16_t low_table_bits { to_u16(state.table.cards & LOW_MASK) };
+    uint16_t hand_ranks { to_u16(current_player_state(state).hand.ranks()) };
 
-    for (const Rank& card : current_player_state(game).hand.cards) {
+    while (hand_ranks) {
+        const Rank card { to_rank(static_cast<uint16_t>(hand_ranks & -hand_ranks)) };
+        hand_ranks &= static_cast<uint16_t>(hand_ranks - 1);
+
+        const Rank_Moves& rank_moves { MOVES_BY_RANK[static_cast<size_t>(rank_to_int(card))][low_table_bits] };
+        for (size_t i{}; i < rank_moves.size; i++) {
+            assert(available_moves.size() < MAX_MOVES_PER_TABLE);
+            available_moves.push_back(rank_moves.moves[i]);
+        }
+    }
+    return available_moves;
+}
+
+util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves_reference(const Search_State& state) {
+
+    util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> available_moves{};
+
+    const RankMask low_table_mask { state.table.cards & LOW_MASK };
+    uint16_t hand_ranks { to_u16(current_player_state(state).hand.ranks()) };
+
+    while (hand_ranks) {
+        const Rank card { to_rank(static_cast<uint16_t>(hand_ranks & -hand_ranks)) };
+        hand_ranks &= static_cast<uint16_t>(hand_ranks - 1);
 
         assert(available_moves.size() < MAX_MOVES_PER_TABLE);
         available_moves.push_back(to_mask(card));
 
         const int rank_idx { rank_to_int(card) };
 
-        // todo: make better?
         for (const RankMask addition_pattern : ADDITIONS_BY_RANK[rank_idx]) {
             if ((addition_pattern & low_table_mask) == addition_pattern) {
-                RankMask move { addition_pattern | to_mask(card) };
-                if (!available_moves.contains(move)) {
-                    assert(available_moves.size() < MAX_MOVES_PER_TABLE);
-                    available_moves.push_back(move);
-                }
+                assert(available_moves.size() < MAX_MOVES_PER_TABLE);
+                available_moves.push_back(addition_pattern | to_mask(card));
             }
         }
     }
     return available_moves;
 }
 
+util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves(const Game_State& game) {
+    return generate_all_moves(to_search_state(game));
+}
+
+namespace {
+
+// The packed walk takes the search's unchecked path; Game_State stays the
+// checked reference it is compared against.
+Undo perft_make(Search_State& state, const Move& move) { return make_move_unchecked(state, move); }
+Undo perft_make(Game_State& game, const Move& move)    { return make_move_in_place(game, move); }
+
+void perft_undo(Search_State& state, const Undo& undo) { undo_move_unchecked(state, undo); }
+void perft_undo(Game_State& game, const Undo& undo)    { undo_move_in_place(game, undo); }
+
+template <class State>
+uint64_t perft_impl(State& state, const int depth) {
+    if (depth == 0) { return 1; }
+
+    const auto moves { generate_all_moves(state) };
+    uint64_t leaves {};
+    for (size_t i{}; i < moves.size(); i++) {
+        const Undo undo { perft_make(state, Move{ moves.at(i) }) };
+        state.advance_turn();
+        leaves += perft_impl(state, depth - 1);
+        state.unadvance_turn();
+        perft_undo(state, undo);
+    }
+    return leaves;
+}
+
+} // namespace
+
+uint64_t perft(Search_State& state, const int depth) { return perft_impl(state, depth); }
+uint64_t perft(Game_State& game, const int depth)    { return perft_impl(game, depth); }
+
 } // namespace Cuarenta
\ No newline at end of file
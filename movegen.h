@@ -2,7 +2,10 @@
 
 #include "cuarenta.h"
 #include "dynamic_array.h"
+#include "search_state.h"
 
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <cassert>
 
@@ -35,7 +38,49 @@ constexpr RankMask LOW_MASK { to_mask(Rank::Ace)   | to_mask(Rank::Two)  |
                               to_mask(Rank::Three) | to_mask(Rank::Four) |
                               to_mask(Rank::Five)  | to_mask(Rank::Six) };
 
+static constexpr size_t MAX_MOVES_PER_RANK  { 5 };      // single card + up to 4 additions (Seven)
+static constexpr size_t NUM_LOW_TABLE_MASKS { 1u << 6 }; // Ace..Six, the only addition operands
 
+struct Rank_Moves {
+    std::array<RankMask, MAX_MOVES_PER_RANK> moves{};
+    size_t size{};
+};
+
+// Legality of a move only depends on the played rank and the low table bits,
+// so every (rank, low table) pair is resolved at compile time.
+constexpr std::array<std::array<Rank_Moves, NUM_LOW_TABLE_MASKS>, NUM_RANKS + 1> make_moves_by_rank() {
+    std::array<std::array<Rank_Moves, NUM_LOW_TABLE_MASKS>, NUM_RANKS + 1> table{};
+    for (size_t rank_idx{1}; rank_idx <= NUM_RANKS; rank_idx++) {
+        const RankMask card { to_mask(int_to_rank(static_cast<int>(rank_idx))) };
+        for (size_t low{}; low < NUM_LOW_TABLE_MASKS; low++) {
+            Rank_Moves& entry { table[rank_idx][low] };
+            entry.moves[entry.size++] = card;
+            for (const RankMask addition_pattern : ADDITIONS_BY_RANK[rank_idx]) {
+                if ((to_u16(addition_pattern) & low) == to_u16(addition_pattern)) {
+                    entry.moves[entry.size++] = addition_pattern | card;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+// MOVES_BY_RANK[rank_to_int(rank)][table bits & LOW_MASK]
+static constexpr auto MOVES_BY_RANK { make_moves_by_rank() };
+
+// Moves are emitted by ascending played rank, each single-card move followed
+// by its additions. Duplicate ranks in hand produce a single set of moves.
+util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves(const Search_State& state);
+
+// Loop-based generator that walks ADDITIONS_BY_RANK directly; kept as the
+// reference the lookup table is tested and benchmarked against.
+util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves_reference(const Search_State& state);
 util::dynamic_array<RankMask, MAX_MOVES_PER_TABLE> generate_all_moves(const Game_State& game);
 
+// Number of move sequences exactly depth plies long; lines where the player
+// to move runs out of cards earlier count as zero. Scores play no part, so
+// the 40-point cutoff is not applied. The state is restored on return.
+uint64_t perft(Search_State& state, const int depth);
+uint64_t perft(Game_State& game, const int depth);
+
 } // namespace Cuarenta
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "cuarenta.h"
+#include "game_state.h"
+#include "movegen.h"
+#include "rank.h"
+#include "search_state.h"
+#include "timer.h"
+
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void print_usage() {
+    std::cout <<
+        "usage: cuarenta_perft [options]\n"
+        "  --p1 RANKS         hand of the player to move, e.g. A257K (default A2345)\n"
+        "  --p2 RANKS         opponent hand (default 67JQK)\n"
+        "  --table RANKS      cards on the table (default none)\n"
+        "  --last RANK        last card dropped on the table, enables caida\n"
+        "  --depth D          deepest ply to count (default: every card in both hands)\n"
+        "  --divide           break the deepest count down by root move\n"
+        "  --game-state       run on Game_State instead of the packed Search_State\n"
+        "Ranks are A 2 3 4 5 6 7 J Q K; 10 is not a rank.\n";
+}
+
+Cuarenta::Rank parse_rank(const char ch) {
+    const char upper { static_cast<char>(std::toupper(static_cast<unsigned char>(ch))) };
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        const auto rank { Cuarenta::int_to_rank(static_cast<int>(i)) };
+        if (Cuarenta::rank_to_str(rank).front() == upper) { return rank; }
+    }
+    throw std::invalid_argument(std::string{"Unknown rank '"} + ch + "'.\n");
+}
+
+Cuarenta::Hand parse_hand(const std::string& ranks) {
+    Cuarenta::Hand hand{};
+    for (const char ch : ranks) { hand.cards.push_back(parse_rank(ch)); }
+    return hand;
+}
+
+template <class State>
+void run_perft(State& state, const int max_depth, const bool divide) {
+
+    std::cout << std::setw(6) << "depth" << std::setw(16) << "leaves"
+              << std::setw(12) << "ms" << std::setw(14) << "leaves/s" << '\n';
+
+    for (int depth{1}; depth <= max_depth; depth++) {
+        const util::Timer timer{};
+        const uint64_t leaves { Cuarenta::perft(state, depth) };
+        const double ms { timer.elapsed_ms() };
+
+        std::cout << std::setw(6) << depth << std::setw(16) << leaves
+                  << std::setw(12) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(14) << std::setprecision(0)
+                  << ((ms > 0.0) ? static_cast<double>(leaves) * 1000.0 / ms : 0.0)
+                  << '\n' << std::defaultfloat;
+    }
+
+    if (divide) {
+        std::cout << "\ndivide at depth " << max_depth << ":\n";
+        const auto moves { Cuarenta::generate_all_moves(state) };
+        for (size_t i{}; i < moves.size(); i++) {
+            const Cuarenta::Undo undo { Cuarenta::make_move_in_place(state, Cuarenta::Move{ moves.at(i) }) };
+            state.advance_turn();
+            const uint64_t leaves { (max_depth > 0) ? Cuarenta::perft(state, max_depth - 1) : 1 };
+            state.unadvance_turn();
+            Cuarenta::undo_move_in_place(state, undo);
+            std::cout << "  " << std::setw(8) << Cuarenta::mask_to_str(moves.at(i)) << ": " << leaves << '\n';
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    std::string p1 { "A2345" };
+    std::string p2 { "67JQK" };
+    std::string table {};
+    std::string last {};
+    int depth { -1 };
+    bool divide { false };
+    bool use_game_state { false };
+
+    try {
+        for (int i{1}; i < argc; i++) {
+            const std::string_view arg { argv[i] };
+            if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+            if (arg == "--divide")              { divide = true; continue; }
+            if (arg == "--game-state")          { use_game_state = true; continue; }
+            if (i + 1 >= argc) { print_usage(); return 1; }
+            const std::string value { argv[++i] };
+
+            if      (arg == "--p1")    { p1 = value; }
+            else if (arg == "--p2")    { p2 = value; }
+            else if (arg == "--table") { table = value; }
+            else if (arg == "--last")  { last = value; }
+            else if (arg == "--depth") { depth = std::stoi(value); }
+            else {
+                std::cerr << "Unknown option " << arg << '\n';
+                print_usage();
+                return 1;
+            }
+        }
+
+        Cuarenta::Game_State game { parse_hand(p1), parse_hand(p2) };
+        for (const char ch : table) { game.table.cards = game.table.cards | Cuarenta::to_mask(parse_rank(ch)); }
+        if (!last.empty()) {
+            game.table.last_played_card = parse_rank(last.front());
+            if (!Cuarenta::contains_ranks(game.table.cards, Cuarenta::to_mask(game.table.last_played_card))) {
+                throw std::invalid_argument("--last must be a card on the table.\n");
+            }
+        }
+        if (depth < 0) { depth = static_cast<int>(p1.size() + p2.size()); }
+
+        if (use_game_state) {
+            run_perft(game, depth, divide);
+        } else {
+            auto state { Cuarenta::to_search_state(game) };
+            run_perft(state, depth, divide);
+        }
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "ponder.h"
+
+#include "move_ordering.h"
+#include "movegen.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace Bot {
+
+Ponderer::Ponderer(const Bot& bot, const int depth)
+    : bot_{ bot },
+      depth_{ depth },
+      max_samples_{ static_cast<size_t>(std::max(bot.num_mc_iters_, 1)) } {
+    // Replies are searched side by side, so each gets a context of its own.
+    bot_.context_ = nullptr;
+}
+
+Ponderer::~Ponderer() { stop(); }
+
+void Ponderer::start(const Cuarenta::Game_State& game) {
+
+    stop();
+    replies_.clear();
+    error_ = nullptr;
+
+    // ISMCTS has no resumable search to hand over.
+    if (bot_.engine_ != SearchEngine::Pimc) { return; }
+
+    const auto root  { Cuarenta::to_search_state(game) };
+    const auto moves { Cuarenta::generate_all_moves(game) };
+
+    std::vector<std::pair<int, size_t>> order;
+    for (size_t i{}; i < moves.size(); i++) {
+        order.emplace_back(MoveOrdering::static_score(root, moves.at(i)), i);
+    }
+    std::ranges::stable_sort(order, [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& [score, i] : order) {
+        Cuarenta::Game_State reply { game };
+        Cuarenta::make_move_in_place(reply, Cuarenta::Move{ moves.at(i) });
+        reply.advance_turn();
+        // The bot's turn only comes straight after if it still has cards;
+        // otherwise a new deal is coming and nothing can be pondered.
+        if (Cuarenta::current_player_state(reply).hand.cards.empty()) { continue; }
+        replies_.push_back(Reply{ .game = reply, .root = Cuarenta::to_search_state(reply), .search = nullptr });
+    }
+    if (replies_.empty()) { return; }
+
+    thread_ = std::jthread{ [this](std::stop_token stop) { run(stop); } };
+}
+
+void Ponderer::stop() {
+    if (!thread_.joinable()) { return; }
+    thread_.request_stop();
+    thread_.join();
+}
+
+void Ponderer::wait() {
+    if (thread_.joinable()) { thread_.join(); }
+}
+
+std::unique_ptr<AnytimeSearch> Ponderer::take(const Cuarenta::Game_State& game) {
+
+    stop();
+    if (error_) { std::rethrow_exception(std::exchange(error_, nullptr)); }
+
+    const auto root { Cuarenta::to_search_state(game) };
+    for (Reply& reply : replies_) {
+        if (reply.root == root) { return std::move(reply.search); }
+    }
+    return nullptr;
+}
+
+void Ponderer::run(std::stop_token stop) {
+
+    // Searches are built here rather than in start(): each owns a
+    // transposition table, and the caller should get back to the user at once.
+    // Round-robin batches give every reply a head start before any of them
+    // is finished.
+    try {
+        bool progress { true };
+        while (progress && !stop.stop_requested()) {
+            progress = false;
+            for (Reply& reply : replies_) {
+                if (stop.stop_requested()) { return; }
+                if (!reply.search) { reply.search = std::make_unique<AnytimeSearch>(bot_, reply.game, depth_); }
+
+                const size_t have { reply.search->num_samples() };
+                if (have >= max_samples_ || reply.search->num_moves() == 0) { continue; }
+                reply.search->run_batch(std::min(BATCH_SIZE, max_samples_ - have),
+                                        util::Timer::Clock::time_point::max(), stop);
+                progress = true;
+            }
+        }
+    } catch (...) {
+        error_ = std::current_exception();
+    }
+}
+
+} // namespace Bot
@@ -0,0 +1,69 @@
+#pragma once
+#include "bot.h"
+#include "cuarenta.h"
+#include "game_state.h"
+#include "search_state.h"
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace Bot {
+
+// Searches on the opponent's time. start() takes a position with the
+// opponent to move and, on a background thread, grows one AnytimeSearch per
+// position the bot could face after each legal opponent move, a batch at a
+// time, likeliest replies (by MoveOrdering::static_score) first. take() hands
+// over the search whose root is the position actually reached, so the bot
+// only runs the samples it still lacks.
+//
+// Pondered searches assume the bot's beliefs do not change between start()
+// and take(); call stop() and start() again after updating the bot.
+class Ponderer {
+public:
+    static constexpr size_t BATCH_SIZE { 8 };
+
+    Ponderer(const Bot& bot, const int depth);
+    ~Ponderer();
+
+    Ponderer(const Ponderer&) = delete;
+    Ponderer& operator=(const Ponderer&) = delete;
+
+    // Drops every earlier search and starts pondering the replies to game.
+    void start(const Cuarenta::Game_State& game);
+
+    // Cancels pondering and waits for the thread; searches are kept.
+    void stop();
+
+    // Blocks until every reply has num_mc_iters_ samples (or stop()).
+    void wait();
+
+    // Stops pondering and returns the search rooted at game, or null if game
+    // was not among the pondered replies. Rethrows a pondering failure.
+    std::unique_ptr<AnytimeSearch> take(const Cuarenta::Game_State& game);
+
+    const Bot& bot() const { return bot_; }
+    int depth() const { return depth_; }
+    size_t max_samples() const { return max_samples_; }
+
+private:
+    struct Reply {
+        Cuarenta::Game_State game;
+        Cuarenta::Search_State root;
+        std::unique_ptr<AnytimeSearch> search;
+    };
+
+    void run(std::stop_token stop);
+
+    Bot bot_;
+    int depth_;
+    size_t max_samples_;
+    std::vector<Reply> replies_; // owned by the thread while it runs
+    std::exception_ptr error_{};
+    std::jthread thread_;
+};
+
+} // namespace Bot
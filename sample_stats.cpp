@@ -0,0 +1,72 @@
+#include "sample_stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Bot {
+
+SampleStats::SampleStats(size_t num_moves)
+    : num_moves_{ num_moves },
+      mean_(num_moves),
+      comoment_(num_moves * num_moves),
+      delta_(num_moves) {}
+
+void SampleStats::add(std::span<const double> values) {
+    assert(values.size() == num_moves_);
+
+    count_++;
+    const double n { static_cast<double>(count_) };
+
+    // delta_ holds (x - old mean); the co-moment update pairs it with (x - new mean).
+    for (size_t i{}; i < num_moves_; i++) {
+        const double x { std::clamp(values[i], -DECIDED_GAME_VALUE, DECIDED_GAME_VALUE) };
+        delta_[i] = x - mean_[i];
+        mean_[i] += delta_[i] / n;
+    }
+    for (size_t i{}; i < num_moves_; i++) {
+        for (size_t j{}; j < num_moves_; j++) {
+            const double x { std::clamp(values[j], -DECIDED_GAME_VALUE, DECIDED_GAME_VALUE) };
+            comoment(i, j) += delta_[i] * (x - mean_[j]);
+        }
+    }
+}
+
+void SampleStats::merge(const SampleStats& other) {
+    assert(other.num_moves_ == num_moves_);
+    if (other.count_ == 0) { return; }
+    if (count_ == 0) { *this = other; return; }
+
+    const double na { static_cast<double>(count_) };
+    const double nb { static_cast<double>(other.count_) };
+    const double n  { na + nb };
+
+    for (size_t i{}; i < num_moves_; i++) {
+        delta_[i] = other.mean_[i] - mean_[i];
+    }
+    for (size_t i{}; i < num_moves_; i++) {
+        for (size_t j{}; j < num_moves_; j++) {
+            comoment(i, j) += other.comoment(i, j) + delta_[i] * delta_[j] * na * nb / n;
+        }
+    }
+    for (size_t i{}; i < num_moves_; i++) {
+        mean_[i] += delta_[i] * nb / n;
+    }
+    count_ += other.count_;
+}
+
+double SampleStats::covariance(size_t i, size_t j) const {
+    if (count_ < 2) { return 0.0; }
+    return comoment(i, j) / static_cast<double>(count_ - 1);
+}
+
+double SampleStats::diff_variance(size_t i, size_t j) const {
+    return std::max(0.0, covariance(i, i) + covariance(j, j) - 2.0 * covariance(i, j));
+}
+
+double SampleStats::diff_std_error(size_t i, size_t j) const {
+    if (count_ == 0) { return 0.0; }
+    return std::sqrt(diff_variance(i, j) / static_cast<double>(count_));
+}
+
+} // namespace Bot
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Bot {
+
+// Decided games come out of the search as +/- max(); statistics clamp them to
+// this value so means and variances stay finite.
+static constexpr double DECIDED_GAME_VALUE { 100.0 };
+
+// Streaming per-move statistics over PIMC samples. Every sample contributes
+// one value per root move, and moves are compared on the same sampled world,
+// so the paired differences between two moves have far less variance than
+// the moves themselves. Uses Welford updates for the means and the full
+// co-moment matrix (flat, row-major), which gives every paired difference's
+// variance without storing samples.
+class SampleStats {
+public:
+    explicit SampleStats(size_t num_moves = 0);
+
+    void add(std::span<const double> values);
+
+    // Chan et al. pairwise combination; merging in a fixed order is deterministic.
+    void merge(const SampleStats& other);
+
+    size_t count() const     { return count_; }
+    size_t num_moves() const { return num_moves_; }
+
+    double mean(size_t i) const { return mean_[i]; }
+    double variance(size_t i) const { return covariance(i, i); }
+    double covariance(size_t i, size_t j) const;
+
+    // Statistics of (value_i - value_j) over the same samples.
+    double diff_mean(size_t i, size_t j) const { return mean_[i] - mean_[j]; }
+    double diff_variance(size_t i, size_t j) const;
+
+    // Standard error of diff_mean(i, j).
+    double diff_std_error(size_t i, size_t j) const;
+
+private:
+    double& comoment(size_t i, size_t j) { return comoment_[i * num_moves_ + j]; }
+    double comoment(size_t i, size_t j) const { return comoment_[i * num_moves_ + j]; }
+
+    size_t num_moves_{};
+    size_t count_{};
+    std::vector<double> mean_;
+    std::vector<double> comoment_;
+    std::vector<double> delta_; // scratch for add()
+};
+
+} // namespace Bot
@@ -0,0 +1,38 @@
+#include "search_context.h"
+
+namespace Bot {
+
+void SearchContext::prepare(const uint32_t evaluator_id, const uint64_t root_key, const int depth,
+                            const size_t num_workers) {
+
+    if (evaluator_id != evaluator_id_) {
+        clear();
+        evaluator_id_ = evaluator_id;
+    }
+
+    const uint64_t key { splitmix64(root_key ^ static_cast<uint64_t>(depth)) };
+    if (!has_root_ || key != root_key_) {
+        tt_.new_search();
+        for (SampleWorker& worker : workers_) {
+            worker.memo.clear();
+            worker.search.stats = SearchStats{};
+        }
+        root_key_ = key;
+        has_root_ = true;
+    }
+    workers_.resize(num_workers);
+}
+
+void SearchContext::clear() {
+    tt_.clear();
+    workers_.clear();
+    has_root_ = false;
+}
+
+SearchStats SearchContext::search_stats() const {
+    SearchStats total{};
+    for (const SampleWorker& worker : workers_) { total.merge(worker.search.stats); }
+    return total;
+}
+
+} // namespace Bot
@@ -0,0 +1,58 @@
+#pragma once
+#include "cuarenta.h"
+#include "move_ordering.h"
+#include "transposition.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Bot {
+
+// Root move values per sampled opponent hand (keyed on Packed_Hand::counts);
+// the rest of the root is fixed for a decision.
+using WorldMemo = std::unordered_map<uint32_t, std::array<double, Cuarenta::MAX_MOVES_PER_TABLE>>;
+
+// Per-thread state kept across the samples one scheduler worker runs: move
+// ordering and counters, and the root values of every hand it has searched.
+struct SampleWorker {
+    SearchWorker search{};
+    WorldMemo memo{};
+};
+
+// Search data one bot keeps across its decisions within a deal: the
+// transposition table and each worker's move-ordering history. Table values
+// do not depend on the root, so a decision two plies after the last one
+// finds most of its subtrees already searched. World memos only hold for one
+// root and depth, and are dropped as soon as either changes.
+//
+// Used by one search at a time. Copies of a Bot share its context, so bots
+// that play concurrently (e.g. parallel self-play games) each need their own.
+class SearchContext {
+public:
+    explicit SearchContext(const int tt_bits = DEFAULT_TT_BITS) : tt_{ tt_bits } {}
+
+    // Readies the context for a search of root_key to depth on num_workers
+    // threads. A new evaluator invalidates the table; a new root or depth
+    // ages it and resets the memos and counters.
+    void prepare(const uint32_t evaluator_id, const uint64_t root_key, const int depth, const size_t num_workers);
+
+    // Forgets every position; called at deal and reshuffle boundaries.
+    void clear();
+
+    TranspositionTable& tt() { return tt_; }
+    std::vector<SampleWorker>& workers() { return workers_; }
+
+    SearchStats search_stats() const; // summed over workers since the root last changed
+
+private:
+    TranspositionTable tt_;
+    std::vector<SampleWorker> workers_;
+    uint32_t evaluator_id_{};
+    uint64_t root_key_{};
+    bool has_root_{ false };
+};
+
+} // namespace Bot
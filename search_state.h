@@ -0,0 +1,220 @@
+#pragma once
+#include "bit_kernels.h"
+#include "cuarenta.h"
+#include "game_state.h"
+#include "rank.h"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+namespace Cuarenta {
+
+// Multiset of ranks, one 3-bit count per rank: rank i (1-indexed) lives in
+// bits [3(i-1), 3i). A hand holds at most 5 cards, so counts never overflow.
+struct Packed_Hand {
+    uint32_t counts{};
+
+    static constexpr uint32_t COUNT_BITS  { 3 };
+    static constexpr uint32_t COUNT_MASK  { (1u << COUNT_BITS) - 1 };
+    static constexpr uint32_t LOW_BITS    { 01111111111u }; // bit 0 of every count
+    static constexpr uint32_t MAX_COUNT   { COUNT_MASK };
+
+    static constexpr uint32_t shift_for(Rank r) {
+        return COUNT_BITS * static_cast<uint32_t>(rank_to_int(r) - 1);
+    }
+
+    constexpr int count(Rank r) const {
+        return static_cast<int>((counts >> shift_for(r)) & COUNT_MASK);
+    }
+    constexpr bool contains(Rank r) const { return count(r) != 0; }
+    constexpr bool empty() const { return counts == 0; }
+
+    constexpr void add(Rank r) {
+        assert(count(r) < static_cast<int>(MAX_COUNT));
+        counts += 1u << shift_for(r);
+    }
+    constexpr void remove(Rank r) {
+        assert(count(r) > 0);
+        counts -= 1u << shift_for(r);
+    }
+
+    // Neighbouring counts summed into 6-bit lanes, then lanes pairwise, so
+    // no popcount (a library call on baseline x86-64); exact for any counts.
+    constexpr int size() const {
+        constexpr uint32_t EVEN_COUNTS { 0707070707u };
+        const uint32_t pairs { (counts & EVEN_COUNTS) + ((counts >> COUNT_BITS) & EVEN_COUNTS) };
+        const uint32_t quads { pairs + (pairs >> (2 * COUNT_BITS)) };
+        return static_cast<int>((quads & 077u) + ((quads >> 12) & 077u) + ((quads >> 24) & 077u));
+    }
+
+    // Ranks with a non-zero count, as a RankMask.
+    constexpr RankMask ranks() const {
+        uint32_t non_zero { (counts | (counts >> 1) | (counts >> 2)) & LOW_BITS };
+        uint16_t mask {};
+        while (non_zero) {
+            const uint32_t rank_bit { static_cast<uint32_t>(std::countr_zero(non_zero)) / COUNT_BITS };
+            mask = static_cast<uint16_t>(mask | (1u << rank_bit));
+            non_zero &= non_zero - 1;
+        }
+        return to_mask(mask);
+    }
+
+    constexpr bool operator==(const Packed_Hand&) const = default;
+};
+
+struct Packed_Player {
+    Packed_Hand hand{};
+    uint8_t num_captured_cards{};
+    uint8_t score{};
+};
+
+// Compact, trivially copyable mirror of Game_State used inside search.
+// Carries no deck: nothing below the root draws cards.
+struct Search_State {
+    Table table{};
+    std::array<Packed_Player, to_index(Player::NUM_PLAYERS)> players{};
+    Player to_move{ Player::P1 };
+
+    constexpr void advance_turn()   { to_move = (to_move == Player::P1) ? Player::P2 : Player::P1; }
+    constexpr void unadvance_turn() { advance_turn(); }
+
+    constexpr bool operator==(const Search_State& other) const {
+        return table.cards == other.table.cards &&
+               table.last_played_card == other.table.last_played_card &&
+               to_move == other.to_move &&
+               players[0].hand == other.players[0].hand &&
+               players[1].hand == other.players[1].hand &&
+               players[0].num_captured_cards == other.players[0].num_captured_cards &&
+               players[1].num_captured_cards == other.players[1].num_captured_cards &&
+               players[0].score == other.players[0].score &&
+               players[1].score == other.players[1].score;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<Search_State>);
+static_assert(sizeof(Search_State) < 32);
+
+constexpr const Packed_Player& state_for(const Search_State& state, const Player player) {
+    return state.players[to_index(player)];
+}
+
+constexpr Packed_Player& state_for(Search_State& state, const Player player) {
+    return state.players[to_index(player)];
+}
+
+constexpr const Packed_Player& current_player_state(const Search_State& s) {
+    return state_for(s, s.to_move);
+}
+
+constexpr Packed_Player& current_player_state(Search_State& s) {
+    return state_for(s, s.to_move);
+}
+
+constexpr Packed_Player& opposing_player_state(Search_State& s) {
+    return s.players[1 - to_index(s.to_move)];
+}
+
+constexpr const Packed_Player& opposing_player_state(const Search_State& s) {
+    return s.players[1 - to_index(s.to_move)];
+}
+
+// ---- conversions ----
+
+inline Packed_Hand to_packed_hand(const Hand& hand) {
+    Packed_Hand packed{};
+    for (const Rank card : hand.cards) { packed.add(card); }
+    return packed;
+}
+
+// Cards come back sorted by rank.
+inline Hand to_hand(const Packed_Hand packed) {
+    Hand hand{};
+    hand.cards.reserve(static_cast<size_t>(packed.size()));
+    for (size_t i{1}; i <= NUM_RANKS; i++) {
+        const Rank rank { int_to_rank(static_cast<int>(i)) };
+        for (int n{}; n < packed.count(rank); n++) { hand.cards.push_back(rank); }
+    }
+    return hand;
+}
+
+inline Search_State to_search_state(const Game_State& game) {
+    Search_State state { .table = game.table, .players = {}, .to_move = game.to_move };
+    for (size_t p{}; p < state.players.size(); p++) {
+        const Player_State& player { game.players[p] };
+        assert(player.num_captured_cards >= 0 && player.num_captured_cards <= 0xFF);
+        assert(player.score >= 0 && player.score <= 0xFF);
+        state.players[p] = Packed_Player{
+            .hand = to_packed_hand(player.hand),
+            .num_captured_cards = static_cast<uint8_t>(player.num_captured_cards),
+            .score = static_cast<uint8_t>(player.score) };
+    }
+    return state;
+}
+
+// Overwrites everything but the deck, which Search_State does not track.
+inline void from_search_state(Game_State& game, const Search_State& state) {
+    game.table = state.table;
+    game.to_move = state.to_move;
+    for (size_t p{}; p < state.players.size(); p++) {
+        game.players[p].hand = to_hand(state.players[p].hand);
+        game.players[p].num_captured_cards = state.players[p].num_captured_cards;
+        game.players[p].score = state.players[p].score;
+    }
+}
+
+// ---- unchecked make/undo ----
+
+// The search's make/undo: no validation, no throw, small enough to inline
+// into the move loop. The move must be legal in state, as everything
+// generate_all_moves() returns is; debug builds assert it.
+// try_make_move() is the checked entry point for anything else.
+inline Undo make_move_unchecked(Search_State& state, const Move& move) noexcept {
+
+    Packed_Player& player { current_player_state(state) };
+    Table& table          { state.table };
+
+    const uint16_t move_bits { to_u16(move.targets_mask) };
+    const Rank played_card   { to_rank(played_bit(move_bits)) };
+    assert(player.hand.contains(played_card));
+
+    const Move_Effect effect { move_effect(to_u16(table.cards), to_u16(table.last_played_card), move_bits) };
+    assert(effect.is_capture || !is_addition(move_bits));
+
+    const Undo undo { .move = move,
+                      .last_played_card = table.last_played_card,
+                      .num_waterfalled_cards = effect.num_waterfalled };
+
+    table.cards            = to_mask(effect.table_after);
+    table.last_played_card = effect.is_capture ? Rank::Invalid : played_card;
+
+    // Caída and limpia: +2 points each
+    player.num_captured_cards = static_cast<uint8_t>(player.num_captured_cards + effect.num_captured);
+    player.score = static_cast<uint8_t>(player.score + 2 * (static_cast<int>(effect.is_caida) + static_cast<int>(effect.is_limpia)));
+
+    player.hand.remove(played_card);
+    return undo;
+}
+
+// pre-condition: Player to_move is the person that did make_move_unchecked()
+inline void undo_move_unchecked(Search_State& state, const Undo& undo) noexcept {
+
+    Packed_Player& player { current_player_state(state) };
+    Table& table          { state.table };
+
+    const uint16_t move_bits { to_u16(undo.move.targets_mask) };
+    const Move_Effect effect { undo_effect(to_u16(table.cards), to_u16(undo.last_played_card),
+                                           move_bits, undo.num_waterfalled_cards) };
+
+    table.cards            = to_mask(effect.table_after);
+    table.last_played_card = undo.last_played_card;
+
+    player.num_captured_cards = static_cast<uint8_t>(player.num_captured_cards - effect.num_captured);
+    player.score = static_cast<uint8_t>(player.score - 2 * (static_cast<int>(effect.is_caida) + static_cast<int>(effect.is_limpia)));
+
+    player.hand.add(to_rank(played_bit(move_bits)));
+}
+
+} // namespace Cuarenta
@@ -0,0 +1,202 @@
+#include "selfplay.h"
+
+#include "bot.h"
+#include "cuarenta.h"
+#include "game_state.h"
+#include "thread_pool.h"
+#include "timer.h"
+#include "transposition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace selfplay {
+
+static constexpr int MAX_DEALS_PER_GAME { 1000 };
+
+void Match_Summary::add(const Game_Result& result) {
+    num_games++;
+    switch (result.outcome()) {
+        case  1: seat_a_wins++; break;
+        case -1: seat_b_wins++; break;
+        default: draws++;       break;
+    }
+}
+
+double Match_Summary::score_rate() const {
+    if (num_games == 0) { return 0.5; }
+    return (static_cast<double>(seat_a_wins) + 0.5 * static_cast<double>(draws)) / static_cast<double>(num_games);
+}
+
+std::pair<double, double> Match_Summary::confidence_interval(const double z) const {
+    if (num_games == 0) { return { 0.0, 1.0 }; }
+    const double n      { static_cast<double>(num_games) };
+    const double p      { score_rate() };
+    const double denom  { 1.0 + z * z / n };
+    const double centre { (p + z * z / (2.0 * n)) / denom };
+    const double half   { z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denom };
+    return { std::max(0.0, centre - half), std::min(1.0, centre + half) };
+}
+
+uint64_t game_seed(const uint64_t match_seed, const size_t game_index) {
+    return Bot::splitmix64(match_seed ^ Bot::splitmix64(static_cast<uint64_t>(game_index)));
+}
+
+std::pair<int, int> play_game(const Seat& p1, const Seat& p2, const uint64_t seed,
+                              int* num_moves, int* num_deals, Game_Observer* observer) {
+
+    std::seed_seq seq { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    std::mt19937 gen { seq };
+
+    const std::array<const Seat*, 2> seats { &p1, &p2 };
+    std::array<Bot::Bot, 2> bots { p1.bot, p2.bot };
+    bots[0].seed_ = Bot::splitmix64(seed + 1);
+    bots[1].seed_ = Bot::splitmix64(seed + 2);
+    // Games run in parallel, so each bot gets a context of its own.
+    bots[0].context_ = std::make_shared<Bot::SearchContext>();
+    bots[1].context_ = std::make_shared<Bot::SearchContext>();
+
+    Cuarenta::Game_State game { gen };
+    bots[0].update_from_hand(Cuarenta::state_for(game, Cuarenta::Player::P1).hand);
+    bots[1].update_from_hand(Cuarenta::state_for(game, Cuarenta::Player::P2).hand);
+
+    int moves_played {};
+    int deals { 1 };
+    bool round_scored { false };
+
+    auto game_over = [&] {
+        return Cuarenta::state_for(game, Cuarenta::Player::P1).score >= 40 ||
+               Cuarenta::state_for(game, Cuarenta::Player::P2).score >= 40;
+    };
+
+    while (!game_over()) {
+
+        auto& current  { Cuarenta::current_player_state(game) };
+        auto& opponent { Cuarenta::opposing_player_state(game) };
+        const size_t me { Cuarenta::to_index(game.to_move) };
+
+        if (current.hand.cards.empty() && opponent.hand.cards.empty()) {
+
+            if (game.deck.cards.empty()) {
+                Cuarenta::update_captured_cards(game);
+                if (observer) { observer->on_round_end(game); }
+                round_scored = true;
+                if (game_over()) { break; }
+                game.deck = Cuarenta::Deck{ gen };
+                game.table.reset();
+                bots[0].reset_probabilities();
+                bots[1].reset_probabilities();
+            }
+
+            if (++deals > MAX_DEALS_PER_GAME) {
+                throw std::runtime_error("Self-play game exceeded the deal limit.\n");
+            }
+
+            current.hand  = game.deck.draw_hand();
+            opponent.hand = game.deck.draw_hand();
+            bots[me].update_from_hand(current.hand);
+            bots[1 - me].update_from_hand(opponent.hand);
+            game.table.last_played_card = Cuarenta::Rank::Invalid;
+        }
+
+        round_scored = false;
+        if (observer) { observer->on_move(game); }
+
+        const Seat& seat { *seats[me] };
+        const Cuarenta::Move move { seat.budget.has_value()
+            ? Bot::choose_best_move(bots[me], game, seat.depth, seat.budget.value())
+            : Bot::choose_best_move(bots[me], game, seat.depth) };
+
+        const Cuarenta::Table table_before { game.table };
+        Cuarenta::make_move_in_place(game, move);
+        bots[1 - me].update_from_move(move, table_before);
+        game.advance_turn();
+        moves_played++;
+    }
+
+    if (observer && !round_scored) { observer->on_round_end(game); }
+    if (num_moves) { *num_moves = moves_played; }
+    if (num_deals) { *num_deals = deals; }
+    return { Cuarenta::state_for(game, Cuarenta::Player::P1).score,
+             Cuarenta::state_for(game, Cuarenta::Player::P2).score };
+}
+
+Match_Summary run_match(const Match_Config& config, std::ostream& log) {
+
+    std::ofstream csv { config.output_path };
+    if (!csv) {
+        throw std::runtime_error("Could not open " + config.output_path + " for writing.\n");
+    }
+    csv << "game,seed,seat_a_is_p1,seat_a_score,seat_b_score,outcome,moves,deals,seconds\n" << std::flush;
+
+    const util::Timer match_timer{};
+    Match_Summary summary{};
+    std::mutex output_mutex;
+    std::atomic<size_t> next_game { 0 };
+
+    const size_t hardware { std::max<size_t>(1, std::thread::hardware_concurrency()) };
+    const size_t num_workers { std::min(
+        (config.num_threads == 0) ? hardware : config.num_threads,
+        std::max<size_t>(config.num_games, 1)) };
+
+    // Workers pull game indices from a shared counter, so long games do not
+    // hold up a static share of the match.
+    util::ThreadPool::shared().parallel_for(num_workers, [&](size_t) {
+        for (size_t index { next_game++ }; index < config.num_games; index = next_game++) {
+
+            const util::Timer game_timer{};
+            Game_Result result { .game_index = index,
+                                 .seed = game_seed(config.seed, index),
+                                 .seat_a_is_p1 = (index % 2 == 0) };
+
+            const Seat& seat_a { config.seats[0] };
+            const Seat& seat_b { config.seats[1] };
+            const auto [p1_score, p2_score] { result.seat_a_is_p1
+                ? play_game(seat_a, seat_b, result.seed, &result.num_moves, &result.num_deals)
+                : play_game(seat_b, seat_a, result.seed, &result.num_moves, &result.num_deals) };
+
+            result.seat_a_score = result.seat_a_is_p1 ? p1_score : p2_score;
+            result.seat_b_score = result.seat_a_is_p1 ? p2_score : p1_score;
+            result.seconds = game_timer.elapsed_s();
+
+            std::lock_guard lock { output_mutex };
+            csv << result.game_index << ',' << result.seed << ',' << result.seat_a_is_p1 << ','
+                << result.seat_a_score << ',' << result.seat_b_score << ',' << result.outcome() << ','
+                << result.num_moves << ',' << result.num_deals << ',' << result.seconds << '\n' << std::flush;
+
+            summary.add(result);
+            const auto [low, high] { summary.confidence_interval() };
+            log << "game " << std::setw(5) << result.game_index
+                << "  " << result.seat_a_score << "-" << result.seat_b_score
+                << "  A score rate " << std::fixed << std::setprecision(3) << summary.score_rate()
+                << " [" << low << ", " << high << "]"
+                << "  (" << summary.num_games << "/" << config.num_games << ")\n"
+                << std::defaultfloat;
+        }
+    });
+
+    summary.seconds = match_timer.elapsed_s();
+    return summary;
+}
+
+void print_summary(std::ostream& out, const Match_Config& config, const Match_Summary& summary) {
+    const auto [low, high] { summary.confidence_interval() };
+    out << "Seat A (" << config.seats[0].name << ") vs seat B (" << config.seats[1].name << ")\n"
+        << "  games:      " << summary.num_games << " in " << summary.seconds << " s\n"
+        << "  A wins:     " << summary.seat_a_wins << '\n'
+        << "  B wins:     " << summary.seat_b_wins << '\n'
+        << "  draws:      " << summary.draws << '\n'
+        << "  A score rate " << summary.score_rate()
+        << ", 95% CI [" << low << ", " << high << "]\n";
+}
+
+} // namespace selfplay
@@ -0,0 +1,86 @@
+#pragma once
+#include "cuarenta.h"
+#include "game_state.h"
+#include "bot.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace selfplay {
+
+// One side of a match. Each game gets fresh copies of the bot, reseeded
+// from the game seed.
+struct Seat {
+    std::string name { "bot" };
+    Bot::Bot bot { 100 };
+    int depth { 10 };
+    std::optional<Bot::SearchBudget> budget {}; // when set, moves use the budgeted search
+};
+
+struct Game_Result {
+    size_t game_index{};
+    uint64_t seed{};
+    bool seat_a_is_p1{};
+    int seat_a_score{};
+    int seat_b_score{};
+    int num_moves{};
+    int num_deals{};
+    double seconds{};
+
+    // +1 seat A won, 0 draw, -1 seat B won
+    int outcome() const { return (seat_a_score > seat_b_score) - (seat_a_score < seat_b_score); }
+};
+
+struct Match_Config {
+    std::array<Seat, 2> seats {};  // seats[0] is A, seats[1] is B
+    size_t num_games { 100 };
+    uint64_t seed { 0 };
+    size_t num_threads { 0 };       // 0 = every hardware thread
+    std::string output_path { "selfplay_results.csv" };
+};
+
+struct Match_Summary {
+    size_t num_games{};
+    size_t seat_a_wins{};
+    size_t seat_b_wins{};
+    size_t draws{};
+    double seconds{};
+
+    void add(const Game_Result& result);
+
+    // Seat A's score rate, counting draws as half a win.
+    double score_rate() const;
+    // Wilson score interval for score_rate().
+    std::pair<double, double> confidence_interval(const double z = 1.96) const;
+};
+
+// Hooks into play_game for data collection. on_move sees the position
+// before the player to move chooses; on_round_end sees it once a round is
+// scored, or when the game ends mid-round.
+struct Game_Observer {
+    virtual ~Game_Observer() = default;
+    virtual void on_move(const Cuarenta::Game_State&) {}
+    virtual void on_round_end(const Cuarenta::Game_State&) {}
+};
+
+// Deterministic seed for game_index, independent of thread scheduling.
+uint64_t game_seed(const uint64_t match_seed, const size_t game_index);
+
+// Plays one full game to 40 points. Scores are returned in (P1, P2) order.
+std::pair<int, int> play_game(const Seat& p1, const Seat& p2, const uint64_t seed,
+                              int* num_moves = nullptr, int* num_deals = nullptr,
+                              Game_Observer* observer = nullptr);
+
+// Plays num_games across the thread pool, alternating which seat moves
+// first. Every finished game is appended to output_path as a CSV row and
+// flushed; progress goes to log.
+Match_Summary run_match(const Match_Config& config, std::ostream& log);
+
+void print_summary(std::ostream& out, const Match_Config& config, const Match_Summary& summary);
+
+} // namespace selfplay
@@ -0,0 +1,95 @@
+#include "selfplay.h"
+#include "bot.h"
+#include "evaluator.h"
+#include "tablebase.h"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void print_usage() {
+    std::cout <<
+        "usage: cuarenta_selfplay [options]\n"
+        "  --games N          number of games (default 100)\n"
+        "  --seed S           match seed; game i uses a seed derived from (S, i) (default 0)\n"
+        "  --threads T        games played in parallel, 0 = all cores (default 0)\n"
+        "  --out PATH         CSV file, one row per finished game (default selfplay_results.csv)\n"
+        "  --tablebase PATH   endgame tablebase from cuarenta_tbgen, probed by both seats\n"
+        "Per seat, with X = a or b:\n"
+        "  --X-name NAME      label used in the report\n"
+        "  --X-iters N        Monte-Carlo samples per move (default 100)\n"
+        "  --X-depth D        negamax depth (default 10)\n"
+        "  --X-time-ms MS     per-move time budget; enables early stopping\n"
+        "  --X-bot-threads T  sampling threads per move (default 1)\n"
+        "  --X-eval PATH      leaf evaluation tables (default: score difference)\n"
+        "  --X-engine E       pimc or ismcts; for ismcts, iters counts tree iterations (default pimc)\n";
+}
+
+bool parse_seat_option(selfplay::Seat& seat, std::string_view option, const std::string& value) {
+    if (option == "name")        { seat.name = value; }
+    else if (option == "iters")  { seat.bot.num_mc_iters_ = std::stoi(value); }
+    else if (option == "depth")  { seat.depth = std::stoi(value); }
+    else if (option == "time-ms") {
+        seat.budget = Bot::SearchBudget{ .time_limit = std::chrono::milliseconds{ std::stoi(value) } };
+    }
+    else if (option == "bot-threads") { seat.bot.num_threads_ = std::stoi(value); }
+    else if (option == "engine") {
+        if      (value == "pimc")   { seat.bot.engine_ = Bot::SearchEngine::Pimc; }
+        else if (value == "ismcts") { seat.bot.engine_ = Bot::SearchEngine::Ismcts; }
+        else { throw std::invalid_argument("Unknown engine " + value + "\n"); }
+    }
+    else if (option == "eval") {
+        seat.bot.evaluator_ = std::make_shared<const Bot::TableEvaluator>(Bot::TableEvaluator::load(value));
+    }
+    else { return false; }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    selfplay::Match_Config config{};
+    std::optional<Bot::Tablebase> tablebase{};
+    config.seats[0].name = "A";
+    config.seats[1].name = "B";
+
+    try {
+        for (int i{1}; i < argc; i++) {
+            const std::string_view arg { argv[i] };
+            if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+            if (i + 1 >= argc) { print_usage(); return 1; }
+            const std::string value { argv[++i] };
+
+            if      (arg == "--games")   { config.num_games = std::stoul(value); }
+            else if (arg == "--seed")    { config.seed = std::stoull(value); }
+            else if (arg == "--threads") { config.num_threads = std::stoul(value); }
+            else if (arg == "--out")     { config.output_path = value; }
+            else if (arg == "--tablebase") { tablebase = Bot::Tablebase::load(value); }
+            else if (arg.starts_with("--a-") && parse_seat_option(config.seats[0], arg.substr(4), value)) {}
+            else if (arg.starts_with("--b-") && parse_seat_option(config.seats[1], arg.substr(4), value)) {}
+            else {
+                std::cerr << "Unknown option " << arg << '\n';
+                print_usage();
+                return 1;
+            }
+        }
+
+        if (tablebase) { Bot::set_active_tablebase(&tablebase.value()); }
+        const auto summary { selfplay::run_match(config, std::cerr) };
+        selfplay::print_summary(std::cout, config, summary);
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,298 @@
+#include "tablebase.h"
+
+#include "movegen.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Bot {
+
+namespace {
+
+constexpr char MAGIC[8] { 'C', 'U', 'A', 'R', 'T', 'B', '0', '1' };
+constexpr uint32_t FORMAT_VERSION { 1 };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_cards;
+    uint32_t evaluator_id;
+    uint32_t reserved;
+    uint64_t num_entries;
+};
+static_assert(sizeof(Header) == 32);
+
+constexpr size_t NUM_TABLES { size_t{1} << Cuarenta::NUM_RANKS };
+
+// Points one move can earn: caida plus limpia.
+constexpr int MAX_POINTS_PER_MOVE { 4 };
+
+constexpr size_t binomial(const size_t n, const size_t k) {
+    if (k > n) { return 0; }
+    size_t result { 1 };
+    for (size_t i{1}; i <= k; i++) { result = result * (n - k + i) / i; }
+    return result;
+}
+
+// 0 when the mover cannot fall on last_played, otherwise 1 + the position of
+// that rank among the mover's distinct ranks.
+size_t caida_slot(const Cuarenta::Packed_Hand mover, const Cuarenta::Rank last_played,
+                  const Cuarenta::RankMask table) {
+    if (last_played == Cuarenta::Rank::Invalid || !mover.contains(last_played) ||
+        !Cuarenta::contains_ranks(table, Cuarenta::to_mask(last_played))) {
+        return 0;
+    }
+    const uint16_t below { static_cast<uint16_t>(Cuarenta::to_u16(mover.ranks()) & (Cuarenta::to_u16(last_played) - 1)) };
+    return 1 + static_cast<size_t>(std::popcount(below));
+}
+
+Cuarenta::Rank slot_rank(const Cuarenta::Packed_Hand mover, const size_t slot) {
+    if (slot == 0) { return Cuarenta::Rank::Invalid; }
+    uint16_t ranks { Cuarenta::to_u16(mover.ranks()) };
+    for (size_t i{1}; i < slot && ranks; i++) { ranks &= static_cast<uint16_t>(ranks - 1); }
+    return ranks ? Cuarenta::to_rank(static_cast<uint16_t>(ranks & -ranks)) : Cuarenta::Rank::Invalid;
+}
+
+std::atomic<const Tablebase*> g_active_tablebase { nullptr };
+
+} // namespace
+
+struct Tablebase::Mapping {
+    const void* data{};
+    size_t size{};
+
+    Mapping() = default;
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+    ~Mapping() {
+#if !defined(_WIN32)
+        if (data) { munmap(const_cast<void*>(data), size); }
+#endif
+    }
+};
+
+Tablebase::Tablebase(Tablebase&&) noexcept = default;
+Tablebase& Tablebase::operator=(Tablebase&&) noexcept = default;
+Tablebase::~Tablebase() = default;
+
+void Tablebase::init_index(const int max_cards) {
+    if (max_cards < 0 || max_cards > MAX_SUPPORTED_CARDS) {
+        throw std::invalid_argument("Tablebase hands hold at most " +
+                                    std::to_string(MAX_SUPPORTED_CARDS) + " cards.\n");
+    }
+    max_cards_ = max_cards;
+
+    // Multisets of k ranks: C(NUM_RANKS + k - 1, k) per size, smallest first.
+    size_offset_.fill(0);
+    for (size_t k{}; k <= static_cast<size_t>(max_cards); k++) {
+        size_offset_[k + 1] = size_offset_[k] + binomial(Cuarenta::NUM_RANKS + k - 1, k);
+    }
+    num_hands_ = size_offset_[static_cast<size_t>(max_cards) + 1];
+    num_slots_ = static_cast<size_t>(max_cards) + 1;
+
+    hands_.assign(num_hands_, Cuarenta::Packed_Hand{});
+    auto fill = [&](auto& self, Cuarenta::Packed_Hand hand, const size_t min_rank, const int cards_left) -> void {
+        if (cards_left == 0) { hands_[hand_index(hand)] = hand; return; }
+        for (size_t i { min_rank }; i <= Cuarenta::NUM_RANKS; i++) {
+            Cuarenta::Packed_Hand next { hand };
+            next.add(Cuarenta::int_to_rank(static_cast<int>(i)));
+            self(self, next, i, cards_left - 1);
+        }
+    };
+    for (int k{}; k <= max_cards; k++) { fill(fill, Cuarenta::Packed_Hand{}, 1, k); }
+}
+
+// Combinatorial number system: sorted ranks a_1 <= ... <= a_k become the
+// strictly increasing b_i = a_i + (i - 1), ranked as sum C(b_i, i).
+size_t Tablebase::hand_index(const Cuarenta::Packed_Hand hand) const {
+    size_t index {};
+    size_t position {};
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        const int count { hand.count(Cuarenta::int_to_rank(static_cast<int>(i))) };
+        for (int c{}; c < count; c++) {
+            position++;
+            index += binomial(i - 1 + position - 1, position);
+        }
+    }
+    return size_offset_[position] + index;
+}
+
+size_t Tablebase::index_of(const Cuarenta::Packed_Hand mover, const Cuarenta::Packed_Hand opponent,
+                           const Cuarenta::Rank last_played, const Cuarenta::RankMask table) const {
+    const size_t hands { hand_index(mover) * num_hands_ + hand_index(opponent) };
+    return (hands * num_slots_ + caida_slot(mover, last_played, table)) * NUM_TABLES
+         + Cuarenta::to_u16(table);
+}
+
+Tablebase Tablebase::generate(const int max_cards) {
+
+    Tablebase tb{};
+    tb.init_index(max_cards);
+    tb.owned_.assign(tb.num_hands_ * tb.num_hands_ * tb.num_slots_ * NUM_TABLES, 0);
+
+    // Positions are solved in order of cards left in both hands, so every
+    // child a move leads to is already in the table.
+    for (int total{1}; total <= 2 * max_cards; total++) {
+
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (size_t m{}; m < tb.num_hands_; m++) {
+            for (size_t o{}; o < tb.num_hands_; o++) {
+                if (tb.hands_[m].size() + tb.hands_[o].size() == total && !tb.hands_[m].empty()) {
+                    pairs.emplace_back(m, o);
+                }
+            }
+        }
+
+        util::ThreadPool::shared().parallel_for(pairs.size(), [&](const size_t p) {
+            const auto [m, o] { pairs[p] };
+            const Cuarenta::Packed_Hand mover    { tb.hands_[m] };
+            const Cuarenta::Packed_Hand opponent { tb.hands_[o] };
+
+            for (size_t slot{}; slot < tb.num_slots_; slot++) {
+                const Cuarenta::Rank last_played { slot_rank(mover, slot) };
+                if (slot > 0 && last_played == Cuarenta::Rank::Invalid) { continue; }
+
+                for (size_t table{}; table < NUM_TABLES; table++) {
+                    const auto table_mask { Cuarenta::to_mask(static_cast<uint16_t>(table)) };
+                    if (slot > 0 && !Cuarenta::contains_ranks(table_mask, Cuarenta::to_mask(last_played))) { continue; }
+
+                    Cuarenta::Search_State state{};
+                    state.table.cards = table_mask;
+                    state.table.last_played_card = last_played;
+                    state.players[0].hand = mover;
+                    state.players[1].hand = opponent;
+
+                    const auto moves { Cuarenta::generate_all_moves(state) };
+                    int best { std::numeric_limits<int>::min() };
+                    for (size_t i{}; i < moves.size(); i++) {
+                        const Cuarenta::Undo undo { Cuarenta::make_move_unchecked(state, Cuarenta::Move{ moves.at(i) }) };
+                        const int gained { state.players[0].score };
+                        const size_t child { tb.index_of(state.players[1].hand, state.players[0].hand,
+                                                         state.table.last_played_card, state.table.cards) };
+                        best = std::max(best, gained - tb.owned_[child]);
+                        Cuarenta::undo_move_unchecked(state, undo);
+                    }
+                    if (best < std::numeric_limits<int8_t>::min() || best > std::numeric_limits<int8_t>::max()) {
+                        throw std::logic_error("Tablebase value out of range.\n");
+                    }
+                    tb.owned_[tb.index_of(mover, opponent, last_played, table_mask)] = static_cast<int8_t>(best);
+                }
+            }
+        });
+    }
+
+    tb.values_ = tb.owned_;
+    return tb;
+}
+
+void Tablebase::save(const std::string& path) const {
+    std::ofstream out { path, std::ios::binary };
+    if (!out) { throw std::runtime_error("Could not open " + path + " for writing.\n"); }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version      = FORMAT_VERSION;
+    header.max_cards    = static_cast<uint32_t>(max_cards_);
+    header.evaluator_id = evaluator_id_;
+    header.num_entries  = values_.size();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values_.data()), static_cast<std::streamsize>(values_.size()));
+    if (!out) { throw std::runtime_error("Failed writing " + path + ".\n"); }
+}
+
+Tablebase Tablebase::load(const std::string& path) {
+
+    Header header{};
+    {
+        std::ifstream in { path, std::ios::binary };
+        if (!in) { throw std::runtime_error("Could not open tablebase " + path + ".\n"); }
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION) {
+            throw std::runtime_error(path + " is not a tablebase in the current format.\n");
+        }
+    }
+
+    Tablebase tb{};
+    tb.init_index(static_cast<int>(header.max_cards));
+    tb.evaluator_id_ = header.evaluator_id;
+
+    const size_t expected { tb.num_hands_ * tb.num_hands_ * tb.num_slots_ * NUM_TABLES };
+    if (header.num_entries != expected) {
+        throw std::runtime_error(path + " has the wrong number of entries.\n");
+    }
+
+#if !defined(_WIN32)
+    const int fd { ::open(path.c_str(), O_RDONLY) };
+    if (fd >= 0) {
+        struct stat info{};
+        const bool sized { ::fstat(fd, &info) == 0 &&
+                           static_cast<size_t>(info.st_size) == sizeof(Header) + expected };
+        void* data { sized ? ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0)
+                           : MAP_FAILED };
+        ::close(fd);
+        if (data != MAP_FAILED) {
+            tb.mapping_ = std::make_unique<Mapping>();
+            tb.mapping_->data = data;
+            tb.mapping_->size = static_cast<size_t>(info.st_size);
+            tb.values_  = std::span<const int8_t>{ static_cast<const int8_t*>(data) + sizeof(Header), expected };
+            return tb;
+        }
+    }
+#endif
+
+    // No mapping available: read the values into memory.
+    std::ifstream in { path, std::ios::binary };
+    in.seekg(static_cast<std::streamoff>(sizeof(Header)));
+    tb.owned_.resize(expected);
+    in.read(reinterpret_cast<char*>(tb.owned_.data()), static_cast<std::streamsize>(expected));
+    if (!in) { throw std::runtime_error(path + " is truncated.\n"); }
+    tb.values_ = tb.owned_;
+    return tb;
+}
+
+std::optional<int> Tablebase::probe(const Cuarenta::Search_State& state, const int depth) const {
+
+    const auto& mover    { Cuarenta::current_player_state(state) };
+    const auto& opponent { Cuarenta::opposing_player_state(state) };
+    const int mover_cards    { mover.hand.size() };
+    const int opponent_cards { opponent.hand.size() };
+
+    if (mover_cards > max_cards_ || opponent_cards > max_cards_) { return std::nullopt; }
+    if (depth < mover_cards + opponent_cards) { return std::nullopt; }
+
+    // Every card still in play could end up captured by either player.
+    const int cards_in_play { std::popcount(Cuarenta::to_u16(state.table.cards)) + mover_cards + opponent_cards };
+    if (mover.num_captured_cards + cards_in_play >= 20 || opponent.num_captured_cards + cards_in_play >= 20) {
+        return std::nullopt;
+    }
+    if (mover.score + MAX_POINTS_PER_MOVE * mover_cards >= 40 ||
+        opponent.score + MAX_POINTS_PER_MOVE * opponent_cards >= 40) {
+        return std::nullopt;
+    }
+
+    return values_[index_of(mover.hand, opponent.hand, state.table.last_played_card, state.table.cards)];
+}
+
+void set_active_tablebase(const Tablebase* tablebase) {
+    g_active_tablebase.store(tablebase, std::memory_order_release);
+}
+
+const Tablebase* active_tablebase() {
+    return g_active_tablebase.load(std::memory_order_acquire);
+}
+
+} // namespace Bot
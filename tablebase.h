@@ -0,0 +1,91 @@
+#pragma once
+#include "cuarenta.h"
+#include "evaluator.h"
+#include "game_state.h"
+#include "search_state.h"
+#include "rank.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Bot {
+
+// Solved endgames: for every table, last-played card and pair of small hands,
+// the exact negamax value to the end of the deal, stored as the score swing
+// (mover's future points minus the opponent's) on top of heuristic_value().
+//
+// The swing only adds to the heuristic while scoring stays linear, so probe()
+// refuses positions where someone could reach 40 points or 20 captured cards
+// before the hands run out, and positions the search would cut off early.
+//
+// Entry layout, fastest-varying last:
+//   [mover hand][opponent hand][caida slot][table mask]
+// Hands are multisets of at most max_cards cards, ranked with the
+// combinatorial number system. The last-played card only matters to the
+// player about to move, so it is folded into a slot: 0 when the mover cannot
+// fall on it, otherwise 1 + its position among the mover's distinct ranks.
+static constexpr const char* DEFAULT_TABLEBASE_PATH { "cuarenta_endgame.tb" };
+
+class Tablebase {
+public:
+    static constexpr int MAX_SUPPORTED_CARDS { 3 };
+    static constexpr int DEFAULT_MAX_CARDS   { 2 };
+
+    // Evaluators whose leaf values the table was solved against; a table is
+    // only probed by the evaluator it was built for.
+    static constexpr uint32_t SCORE_DIFFERENCE_EVALUATOR { ScoreDifferenceEvaluator::ID };
+
+    // Solves every position with up to max_cards cards per hand in memory.
+    static Tablebase generate(const int max_cards);
+
+    // Memory-maps a file written by save(); read into memory where mapping
+    // is unavailable. Throws std::runtime_error on a missing or bad file.
+    static Tablebase load(const std::string& path);
+
+    void save(const std::string& path) const;
+
+    Tablebase(Tablebase&&) noexcept;
+    Tablebase& operator=(Tablebase&&) noexcept;
+    ~Tablebase();
+
+    // Score swing for the player to move, or nullopt when the position is not
+    // covered or a search to `depth` would not reach the end of the deal.
+    std::optional<int> probe(const Cuarenta::Search_State& state, const int depth) const;
+
+    int max_cards() const { return max_cards_; }
+    uint32_t evaluator_id() const { return evaluator_id_; }
+    size_t size() const { return values_.size(); }
+
+private:
+    struct Mapping; // platform file mapping, see tablebase.cpp
+
+    Tablebase() = default;
+    void init_index(const int max_cards);
+    size_t index_of(const Cuarenta::Packed_Hand mover, const Cuarenta::Packed_Hand opponent,
+                    const Cuarenta::Rank last_played, const Cuarenta::RankMask table) const;
+    size_t hand_index(const Cuarenta::Packed_Hand hand) const;
+
+    int max_cards_{};
+    uint32_t evaluator_id_{ SCORE_DIFFERENCE_EVALUATOR };
+    size_t num_hands_{};
+    size_t num_slots_{};                                         // caida slots: max_cards + 1
+    std::array<size_t, MAX_SUPPORTED_CARDS + 2> size_offset_{}; // first index of each hand size
+    std::vector<Cuarenta::Packed_Hand> hands_;                   // index -> hand
+
+    std::vector<int8_t> owned_;
+    std::unique_ptr<Mapping> mapping_;
+    std::span<const int8_t> values_;
+};
+
+// Process-wide table probed by minimax and negamax; null disables probing.
+// Set it before searching starts; the table must outlive every search.
+void set_active_tablebase(const Tablebase* tablebase);
+const Tablebase* active_tablebase();
+
+} // namespace Bot
@@ -0,0 +1,106 @@
+#include "cuarenta.h"
+#include "game_state.h"
+#include "bot.h"
+#include "movegen.h"
+#include "search_state.h"
+#include "tablebase.h"
+#include "timer.h"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void print_usage() {
+    std::cout <<
+        "usage: cuarenta_tbgen [options]\n"
+        "  --cards N          solve hands of up to N cards each, at most 3 (default 2)\n"
+        "  --out PATH         tablebase file (default cuarenta_endgame.tb)\n"
+        "  --verify N         check N random positions against a full search (default 10000)\n";
+}
+
+// Random positions inside the table's range, with scores and captures low
+// enough for it to apply, compared against minimax with probing disabled.
+int verify(const Bot::Tablebase& tablebase, const int num_positions) {
+    std::mt19937 gen { 1 };
+    int mismatches {};
+    int probed {};
+
+    for (int n{}; n < num_positions; n++) {
+        Cuarenta::Search_State state{};
+        state.table.cards = Cuarenta::to_mask(static_cast<uint16_t>(gen() & Cuarenta::ALL_RANK_BITS));
+        const int mover_cards    { static_cast<int>(gen() % static_cast<uint32_t>(tablebase.max_cards())) + 1 };
+        const int opponent_cards { mover_cards - static_cast<int>(gen() % 2) };
+        for (int c{}; c < mover_cards; c++)    { state.players[0].hand.add(Cuarenta::int_to_rank(static_cast<int>(gen() % 10) + 1)); }
+        for (int c{}; c < opponent_cards; c++) { state.players[1].hand.add(Cuarenta::int_to_rank(static_cast<int>(gen() % 10) + 1)); }
+        if (const uint16_t table { Cuarenta::to_u16(state.table.cards) }; table != 0 && gen() % 2 == 0) {
+            state.table.last_played_card = Cuarenta::to_rank(static_cast<uint16_t>(1u << std::countr_zero(table)));
+        }
+        for (auto& player : state.players) {
+            player.score = static_cast<uint8_t>(gen() % 20);
+            player.num_captured_cards = static_cast<uint8_t>(gen() % 6);
+        }
+
+        const auto probe { tablebase.probe(state, 10) };
+        if (!probe) { continue; }
+        probed++;
+
+        Bot::set_active_tablebase(nullptr);
+        const double searched { Bot::minimax(state, 10) };
+        Bot::set_active_tablebase(&tablebase);
+        const double solved { Bot::minimax(state, 10) };
+
+        if (searched != solved && mismatches++ == 0) {
+            std::cerr << "first mismatch: searched " << searched << ", tablebase " << solved << '\n';
+        }
+    }
+    Bot::set_active_tablebase(nullptr);
+    std::cout << "verified " << probed << " positions, " << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    int max_cards { Bot::Tablebase::DEFAULT_MAX_CARDS };
+    std::string output_path { Bot::DEFAULT_TABLEBASE_PATH };
+    int num_verify { 10000 };
+
+    try {
+        for (int i{1}; i < argc; i++) {
+            const std::string_view arg { argv[i] };
+            if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+            if (i + 1 >= argc) { print_usage(); return 1; }
+            const std::string value { argv[++i] };
+
+            if      (arg == "--cards")  { max_cards = std::stoi(value); }
+            else if (arg == "--out")    { output_path = value; }
+            else if (arg == "--verify") { num_verify = std::stoi(value); }
+            else {
+                std::cerr << "Unknown option " << arg << '\n';
+                print_usage();
+                return 1;
+            }
+        }
+
+        const util::Timer timer{};
+        const auto tablebase { Bot::Tablebase::generate(max_cards) };
+        std::cout << "solved " << tablebase.size() << " entries in " << timer.elapsed_s() << " s\n";
+
+        tablebase.save(output_path);
+        const auto loaded { Bot::Tablebase::load(output_path) };
+        std::cout << "wrote " << output_path << '\n';
+
+        if (num_verify > 0 && verify(loaded, num_verify) != 0) { return 1; }
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace util {
+
+ThreadPool::ThreadPool(size_t num_workers) {
+    num_workers = std::max<size_t>(num_workers, 1);
+    workers_.reserve(num_workers);
+    for (size_t i{}; i < num_workers; i++) {
+        workers_.emplace_back([this](std::stop_token stop) { worker_loop(stop); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    for (auto& worker : workers_) { worker.request_stop(); }
+    work_available_.notify_all();
+}
+
+// pre-condition: lock is held. Releases it while the task runs.
+bool ThreadPool::run_one(std::unique_lock<std::mutex>& lock) {
+    if (queue_.empty()) { return false; }
+    auto task { std::move(queue_.front()) };
+    queue_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+    return true;
+}
+
+void ThreadPool::worker_loop(std::stop_token stop) {
+    std::unique_lock lock { mutex_ };
+    while (true) {
+        work_available_.wait(lock, stop, [this] { return !queue_.empty(); });
+        if (stop.stop_requested()) { return; }
+        run_one(lock);
+    }
+}
+
+void ThreadPool::parallel_for(size_t num_tasks, const std::function<void(size_t)>& task) {
+    if (num_tasks == 0) { return; }
+    if (num_tasks == 1) { task(0); return; }
+
+    size_t remaining { num_tasks };
+    std::exception_ptr error {};
+
+    std::unique_lock lock { mutex_ };
+    for (size_t i{}; i < num_tasks; i++) {
+        queue_.emplace_back([&, i] {
+            try { task(i); }
+            catch (...) {
+                std::lock_guard error_lock { mutex_ };
+                if (!error) { error = std::current_exception(); }
+            }
+            std::lock_guard done_lock { mutex_ };
+            if (--remaining == 0) { work_finished_.notify_all(); }
+        });
+    }
+    work_available_.notify_all();
+
+    while (remaining != 0) {
+        if (!run_one(lock)) {
+            work_finished_.wait(lock, [&] { return remaining == 0 || !queue_.empty(); });
+        }
+    }
+    lock.unlock();
+
+    if (error) { std::rethrow_exception(error); }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool {};
+    return pool;
+}
+
+} // namespace util
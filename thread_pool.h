@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_workers = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t num_workers() const { return workers_.size(); }
+
+    // Runs task(0) ... task(num_tasks - 1) and blocks until all have finished.
+    // The calling thread helps drain the queue while it waits, so nested calls
+    // from inside a task cannot deadlock.
+    void parallel_for(size_t num_tasks, const std::function<void(size_t)>& task);
+
+    // Process-wide pool sized to the hardware.
+    static ThreadPool& shared();
+
+private:
+    void worker_loop(std::stop_token stop);
+    bool run_one(std::unique_lock<std::mutex>& lock);
+
+    std::mutex mutex_;
+    std::condition_variable_any work_available_;
+    std::condition_variable work_finished_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace util
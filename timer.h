@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+
+namespace util {
+
+class Timer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Timer() : start_{ Clock::now() } {}
+
+    void reset() { start_ = Clock::now(); }
+
+    Clock::duration elapsed() const { return Clock::now() - start_; }
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(elapsed()).count();
+    }
+    double elapsed_s() const {
+        return std::chrono::duration<double>(elapsed()).count();
+    }
+
+    Clock::time_point start() const { return start_; }
+
+private:
+    Clock::time_point start_;
+};
+
+} // namespace util
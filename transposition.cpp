@@ -0,0 +1,129 @@
+#include "transposition.h"
+
+#include "cuarenta.h"
+#include "game_state.h"
+#include "search_state.h"
+#include "rank.h"
+
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Bot {
+
+uint64_t hash_state(const Cuarenta::Search_State& state) {
+
+    uint64_t key {};
+
+    uint16_t table_bits { Cuarenta::to_u16(state.table.cards) };
+    while (table_bits) {
+        key ^= ZOBRIST.table_card[static_cast<size_t>(std::countr_zero(table_bits))];
+        table_bits &= static_cast<uint16_t>(table_bits - 1);
+    }
+    key ^= ZOBRIST.last_played[static_cast<size_t>(Cuarenta::rank_to_int(state.table.last_played_card))];
+
+    for (size_t p{}; p < NUM_PLAYERS; p++) {
+        const Cuarenta::Packed_Player& player { state.players[p] };
+
+        uint32_t counts { player.hand.counts };
+        for (size_t r{}; counts != 0; r++) {
+            key ^= ZOBRIST.hand_count[p][r][counts & Cuarenta::Packed_Hand::COUNT_MASK];
+            counts >>= Cuarenta::Packed_Hand::COUNT_BITS;
+        }
+
+        assert(player.num_captured_cards < MAX_HASHED_COUNTER);
+        assert(player.score < MAX_HASHED_COUNTER);
+        key ^= ZOBRIST.captured[p][player.num_captured_cards];
+        key ^= ZOBRIST.score[p][player.score];
+    }
+
+    if (state.to_move == Cuarenta::Player::P2) { key ^= ZOBRIST.p2_to_move; }
+    return key;
+}
+
+uint64_t hash_state(const Cuarenta::Game_State& game) {
+    return hash_state(Cuarenta::to_search_state(game));
+}
+
+namespace {
+
+// data layout: [0, 32) value as float bits, [32, 40) depth,
+//              [40, 48) bound, [48, 56) generation
+uint32_t encode_value(double value) {
+    constexpr double float_max { std::numeric_limits<float>::max() };
+    float f {};
+    if      (value >=  float_max) { f =  std::numeric_limits<float>::infinity(); }
+    else if (value <= -float_max) { f = -std::numeric_limits<float>::infinity(); }
+    else                          { f = static_cast<float>(value); }
+    return std::bit_cast<uint32_t>(f);
+}
+
+double decode_value(uint32_t bits) {
+    const float f { std::bit_cast<float>(bits) };
+    if (std::isinf(f)) {
+        return (f > 0) ? std::numeric_limits<double>::max()
+                       : std::numeric_limits<double>::lowest();
+    }
+    return static_cast<double>(f);
+}
+
+uint64_t pack(const TTEntry& entry, uint8_t generation) {
+    assert(entry.depth >= 0 && entry.depth < 256);
+    return static_cast<uint64_t>(encode_value(entry.value))
+         | (static_cast<uint64_t>(entry.depth) << 32)
+         | (static_cast<uint64_t>(entry.bound) << 40)
+         | (static_cast<uint64_t>(generation)  << 48);
+}
+
+int unpack_depth(uint64_t data)          { return static_cast<int>((data >> 32) & 0xFF); }
+Bound unpack_bound(uint64_t data)        { return static_cast<Bound>((data >> 40) & 0xFF); }
+uint8_t unpack_generation(uint64_t data) { return static_cast<uint8_t>((data >> 48) & 0xFF); }
+
+} // namespace
+
+TranspositionTable::TranspositionTable(int size_bits)
+    : slots_{ std::make_unique<Slot[]>(size_t{1} << size_bits) },
+      mask_{ (size_t{1} << size_bits) - 1 } {}
+
+std::optional<TTEntry> TranspositionTable::probe(uint64_t key) const {
+    const Slot& slot { slots_[key & mask_] };
+    const uint64_t data  { slot.data.load(std::memory_order_relaxed) };
+    const uint64_t check { slot.check.load(std::memory_order_relaxed) };
+
+    if ((check ^ data) != key || unpack_bound(data) == Bound::None) { return std::nullopt; }
+
+    return TTEntry{ .value = decode_value(static_cast<uint32_t>(data)),
+                    .depth = unpack_depth(data),
+                    .bound = unpack_bound(data) };
+}
+
+// Replacement policy: always overwrite the same position or a stale entry,
+// otherwise keep whichever entry was searched deeper.
+void TranspositionTable::store(uint64_t key, const TTEntry& entry) {
+    Slot& slot { slots_[key & mask_] };
+    const uint64_t old_data  { slot.data.load(std::memory_order_relaxed) };
+    const uint64_t old_check { slot.check.load(std::memory_order_relaxed) };
+
+    const bool same_key { (old_check ^ old_data) == key };
+    const bool is_stale { unpack_generation(old_data) != generation_ || unpack_bound(old_data) == Bound::None };
+
+    if (!same_key && !is_stale && entry.depth < unpack_depth(old_data)) { return; }
+
+    const uint64_t data { pack(entry, generation_) };
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::new_search() {
+    generation_++;
+}
+
+void TranspositionTable::clear() {
+    for (size_t i{}; i <= mask_; i++) {
+        slots_[i].data.store(0, std::memory_order_relaxed);
+        slots_[i].check.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace Bot
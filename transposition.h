@@ -0,0 +1,106 @@
+#pragma once
+#include "cuarenta.h"
+#include "game_state.h"
+#include "search_state.h"
+#include "rank.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+
+namespace Bot {
+
+// ---- Zobrist keys ----
+// Generated at compile time with splitmix64 so hashes are stable across runs.
+
+constexpr uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static constexpr size_t NUM_PLAYERS { Cuarenta::to_index(Cuarenta::Player::NUM_PLAYERS) };
+static constexpr size_t NUM_HAND_COUNTS { Cuarenta::Packed_Hand::MAX_COUNT + 1 };
+static constexpr int MAX_HASHED_COUNTER { 64 };
+
+struct ZobristKeys {
+    std::array<uint64_t, Cuarenta::NUM_RANKS> table_card{};
+    std::array<uint64_t, Cuarenta::NUM_RANKS + 1> last_played{};   // index 0 = Rank::Invalid
+    std::array<std::array<std::array<uint64_t, NUM_HAND_COUNTS>, Cuarenta::NUM_RANKS>, NUM_PLAYERS> hand_count{};
+    std::array<std::array<uint64_t, MAX_HASHED_COUNTER>, NUM_PLAYERS> captured{};
+    std::array<std::array<uint64_t, MAX_HASHED_COUNTER>, NUM_PLAYERS> score{};
+    uint64_t p2_to_move{};
+};
+
+constexpr ZobristKeys make_zobrist_keys() {
+    ZobristKeys keys{};
+    uint64_t seed { 0x43756172656e7461ULL };
+    auto next = [&seed]() { seed = splitmix64(seed); return seed; };
+
+    for (auto& k : keys.table_card)  { k = next(); }
+    for (auto& k : keys.last_played) { k = next(); }
+    keys.last_played[0] = 0;
+    for (auto& player : keys.hand_count) {
+        for (auto& rank : player) {
+            for (auto& k : rank) { k = next(); }
+            rank[0] = 0;
+        }
+    }
+    for (auto& player : keys.captured) { for (auto& k : player) { k = next(); } }
+    for (auto& player : keys.score)    { for (auto& k : player) { k = next(); } }
+    keys.p2_to_move = next();
+    return keys;
+}
+
+static constexpr ZobristKeys ZOBRIST { make_zobrist_keys() };
+
+// Hashes everything the negamax value depends on. Absolute scores are hashed
+// (not just their difference) because the 40-point cutoff depends on them.
+uint64_t hash_state(const Cuarenta::Search_State& state);
+uint64_t hash_state(const Cuarenta::Game_State& game);
+
+// ---- Transposition table ----
+
+enum class Bound : uint8_t { None = 0, Exact = 1, Lower = 2, Upper = 3 };
+
+struct TTEntry {
+    double value{};
+    int depth{};
+    Bound bound{ Bound::None };
+};
+
+static constexpr int DEFAULT_TT_BITS { 18 }; // 2^18 entries, 16 bytes each
+
+// Fixed-size, lock-free table. Each slot stores (key ^ data, data) in two
+// relaxed atomics, so a torn write from a concurrent store fails the key
+// check instead of returning a corrupted entry.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(int size_bits = DEFAULT_TT_BITS);
+
+    std::optional<TTEntry> probe(uint64_t key) const;
+    void store(uint64_t key, const TTEntry& entry);
+
+    // Marks existing entries as stale so they are preferred for replacement.
+    void new_search();
+    void clear();
+
+    size_t size() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{};
+        std::atomic<uint64_t> data{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_{};
+    uint8_t generation_{};
+};
+
+} // namespace Bot
@@ -1,3 +1,887 @@
+#include "cuarenta.h"
+#include "game_state.h"
+#include "batch_search.h"
+#include "bit_kernels.h"
+#include "bootstrap.h"
+#include "bot.h"
+#include "evaluator.h"
+#include "hand_sampler.h"
+#include "inference.h"
+#include "move_ordering.h"
+#include "movegen.h"
+#include "ponder.h"
+#include "rank.h"
+#include "search_context.h"
+#include "search_state.h"
+#include "tablebase.h"
+#include "work_stealing.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures {};
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond "\n"; \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+Cuarenta::Search_State state_with(uint16_t hand_ranks, uint16_t table_cards) {
+    Cuarenta::Search_State state{};
+    state.table.cards = Cuarenta::to_mask(table_cards);
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        const auto rank { Cuarenta::int_to_rank(static_cast<int>(i)) };
+        if (hand_ranks & Cuarenta::to_u16(rank)) {
+            Cuarenta::current_player_state(state).hand.add(rank);
+        }
+    }
+    return state;
+}
+
+// Every set of hand ranks a 5-card hand can hold against every table: the
+// lookup table must emit exactly the reference generator's moves, in order.
+void test_movegen_lookup_matches_reference() {
+    int mismatches {};
+    for (uint32_t hand{}; hand <= Cuarenta::ALL_RANK_BITS; hand++) {
+        if (std::popcount(hand) > 5) { continue; }
+        for (uint32_t table{}; table <= Cuarenta::ALL_RANK_BITS; table++) {
+            const auto state     { state_with(static_cast<uint16_t>(hand), static_cast<uint16_t>(table)) };
+            const auto fast      { Cuarenta::generate_all_moves(state) };
+            const auto reference { Cuarenta::generate_all_moves_reference(state) };
+
+            bool same { fast.size() == reference.size() };
+            for (size_t i{}; same && i < fast.size(); i++) {
+                same = fast.at(i) == reference.at(i);
+            }
+            if (!same && mismatches++ == 0) {
+                std::cerr << "first movegen mismatch: hand " << hand << ", table " << table << '\n';
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+Cuarenta::Hand hand_of(const std::string& ranks) {
+    Cuarenta::Hand hand{};
+    for (const char ch : ranks) {
+        for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+            const auto rank { Cuarenta::int_to_rank(static_cast<int>(i)) };
+            if (Cuarenta::rank_to_str(rank).front() == ch) { hand.cards.push_back(rank); }
+        }
+    }
+    return hand;
+}
+
+// Hands are compared as multisets: undo returns a card to the back of the hand.
+bool same_state(const Cuarenta::Game_State& a, const Cuarenta::Game_State& b) {
+    if (a.table.cards != b.table.cards ||
+        a.table.last_played_card != b.table.last_played_card ||
+        a.to_move != b.to_move) {
+        return false;
+    }
+    for (size_t p{}; p < a.players.size(); p++) {
+        auto hand_a { a.players[p].hand.cards };
+        auto hand_b { b.players[p].hand.cards };
+        std::ranges::sort(hand_a);
+        std::ranges::sort(hand_b);
+        if (hand_a != hand_b ||
+            a.players[p].num_captured_cards != b.players[p].num_captured_cards ||
+            a.players[p].score != b.players[p].score) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Perft_Case {
+    const char* p1;
+    const char* p2;
+    const char* table;
+    Cuarenta::Rank last_played;
+    std::vector<uint64_t> leaves; // leaves[d - 1] = perft(d)
+};
+
+// Known-good counts; regenerate with cuarenta_perft when the rules change.
+const std::array<Perft_Case, 3> PERFT_CASES {{
+    { "A2345", "67JQK", "",   Cuarenta::Rank::Invalid,
+      { 5, 25, 100, 440, 1480, 5664, 14256, 39660, 52860, 74820 } },
+    { "A257K", "3346Q", "4J", Cuarenta::Rank::Jack,
+      { 5, 21, 93, 344, 1220, 3833, 9094, 21532, 25370, 31778 } },
+    { "A25",   "377",   "46", Cuarenta::Rank::Invalid,
+      { 3, 7, 17, 50, 63, 145 } },
+}};
+
+Cuarenta::Game_State perft_position(const Perft_Case& c) {
+    Cuarenta::Game_State game { hand_of(c.p1), hand_of(c.p2) };
+    game.table.cards = Cuarenta::to_mask(0);
+    for (const Cuarenta::Rank rank : hand_of(c.table).cards) {
+        game.table.cards = game.table.cards | Cuarenta::to_mask(rank);
+    }
+    game.table.last_played_card = c.last_played;
+    return game;
+}
+
+void test_perft_known_counts() {
+    for (const Perft_Case& c : PERFT_CASES) {
+        auto game  { perft_position(c) };
+        auto state { Cuarenta::to_search_state(game) };
+        const auto game_before  { game };
+        const auto state_before { state };
+
+        for (size_t d{1}; d <= c.leaves.size(); d++) {
+            CHECK(Cuarenta::perft(state, static_cast<int>(d)) == c.leaves[d - 1]);
+            CHECK(Cuarenta::perft(game, static_cast<int>(d)) == c.leaves[d - 1]);
+        }
+        CHECK(state == state_before);
+        CHECK(same_state(game, game_before));
+    }
+}
+
+// Random deals walked move by move: at every node, each legal move followed
+// by its undo must restore the exact state, on both representations.
+void test_make_undo_round_trip() {
+    int game_mismatches {};
+    int packed_mismatches {};
+    uint64_t moves_checked {};
+
+    for (uint32_t seed{}; seed < 500; seed++) {
+        std::mt19937 gen { seed };
+        Cuarenta::Game_State game { gen };
+
+        // Start from random scores so the score counters are not all zero.
+        game.players[0].score = static_cast<int>(gen() % 40);
+        game.players[1].score = static_cast<int>(gen() % 40);
+
+        while (!Cuarenta::current_player_state(game).hand.cards.empty()) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+
+            for (size_t i{}; i < moves.size(); i++) {
+                const Cuarenta::Move move { moves.at(i) };
+
+                const auto game_before { game };
+                const Cuarenta::Undo undo { Cuarenta::make_move_in_place(game, move) };
+                Cuarenta::undo_move_in_place(game, undo);
+                if (!same_state(game, game_before) && game_mismatches++ == 0) {
+                    std::cerr << "first Game_State round-trip mismatch: seed " << seed
+                              << ", move " << Cuarenta::mask_to_str(move.targets_mask) << '\n';
+                }
+
+                auto state { Cuarenta::to_search_state(game) };
+                const auto state_before { state };
+                const Cuarenta::Undo packed_undo { Cuarenta::make_move_in_place(state, move) };
+                Cuarenta::undo_move_in_place(state, packed_undo);
+                if (!(state == state_before) && packed_mismatches++ == 0) {
+                    std::cerr << "first Search_State round-trip mismatch: seed " << seed
+                              << ", move " << Cuarenta::mask_to_str(move.targets_mask) << '\n';
+                }
+                moves_checked++;
+            }
+
+            std::uniform_int_distribution<size_t> pick { 0, moves.size() - 1 };
+            Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(pick(gen)) });
+            game.advance_turn();
+        }
+    }
+    CHECK(moves_checked > 0);
+    CHECK(game_mismatches == 0);
+    CHECK(packed_mismatches == 0);
+}
+
+// Whole hands are dealt without replacement: a rank never appears more often
+// than it has cards left, and zero-weight ranks are never dealt.
+void test_hand_sampler_respects_counts() {
+    std::mt19937 gen { 7 };
+    int violations {};
+
+    for (int config{}; config < 2000; config++) {
+        Bot::RankProbabilities probs { Bot::full_deck_probabilities() };
+        int num_weighted {};
+        for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+            probs[i].count = static_cast<int>(gen() % 5);
+            probs[i].probability_weight = (gen() % 4 == 0) ? 0.0 : 0.25 + static_cast<double>(gen() % 8);
+            if (probs[i].probability_weight > 0.0) { num_weighted += probs[i].count; }
+        }
+        const Bot::HandSampler sampler { probs };
+        const int hand_size { std::min(5, num_weighted) };
+
+        for (int draw{}; draw < 20; draw++) {
+            const auto hand { sampler.sample(hand_size, gen) };
+            bool ok { hand.size() == hand_size };
+            for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+                const int dealt { hand.count(Cuarenta::int_to_rank(static_cast<int>(i))) };
+                ok = ok && dealt <= probs[i].count && (probs[i].probability_weight > 0.0 || dealt == 0);
+            }
+            if (!ok) { violations++; }
+        }
+    }
+    CHECK(violations == 0);
+
+    // One Ace and four Kings left: the only possible 5-card hand.
+    Bot::RankProbabilities probs { Bot::full_deck_probabilities() };
+    for (auto& prob : probs) { prob.count = 0; }
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::Ace)].count  = 1;
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::King)].count = 4;
+    const auto forced { Bot::HandSampler{ probs }.sample(5, gen) };
+    CHECK(forced.count(Cuarenta::Rank::Ace) == 1);
+    CHECK(forced.count(Cuarenta::Rank::King) == 4);
+
+    // A single draw picks a rank with probability count * weight / total.
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::King)].count = 1;
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::Ace)].probability_weight = 3.0;
+    const Bot::HandSampler skewed { probs };
+    int aces {};
+    for (int draw{}; draw < 20000; draw++) {
+        aces += skewed.sample(1, gen).count(Cuarenta::Rank::Ace);
+    }
+    CHECK(aces > 14700 && aces < 15300); // 0.75 +/- ~7 standard errors
+}
+
+// Enumerated worlds cover every hand sample() can deal, their exact
+// probabilities sum to one, and they match the sampler's frequencies.
+void test_hand_sampler_enumeration() {
+    Bot::RankProbabilities probs { Bot::full_deck_probabilities() };
+    for (auto& prob : probs) { prob.count = 0; }
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::Ace)]   = { .probability_weight = 1.0, .count = 3 };
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::Five)]  = { .probability_weight = 0.5, .count = 2 };
+    probs[Cuarenta::rank_to_int(Cuarenta::Rank::Queen)] = { .probability_weight = 2.0, .count = 1 };
+    const Bot::HandSampler sampler { probs };
+
+    const auto worlds { sampler.enumerate(3, 100) };
+    CHECK(worlds.size() == 6); // AAA AA5 AAQ A55 A5Q 55Q
+    double total {};
+    for (const auto& world : worlds) { total += world.probability; }
+    CHECK(std::abs(total - 1.0) < 1e-12);
+    CHECK(sampler.enumerate(3, 5).empty());
+
+    std::mt19937 gen { 11 };
+    constexpr int NUM_DRAWS { 60000 };
+    std::vector<int> hits(worlds.size());
+    for (int draw{}; draw < NUM_DRAWS; draw++) {
+        const auto hand { sampler.sample(3, gen) };
+        for (size_t w{}; w < worlds.size(); w++) {
+            if (worlds[w].hand == hand) { hits[w]++; }
+        }
+    }
+    for (size_t w{}; w < worlds.size(); w++) {
+        const double p { worlds[w].probability };
+        const double sigma { std::sqrt(p * (1.0 - p) / NUM_DRAWS) };
+        CHECK(std::abs(hits[w] / static_cast<double>(NUM_DRAWS) - p) < 6.0 * sigma + 1e-9);
+    }
+}
+
+double weight_of(const Bot::Bot& bot, const Cuarenta::Rank rank) {
+    return bot.hand_prob[static_cast<size_t>(Cuarenta::rank_to_int(rank))].probability_weight;
+}
+
+void test_inference_from_non_plays() {
+    const auto mask_of = [](const std::string& ranks) {
+        Cuarenta::RankMask mask {};
+        for (const Cuarenta::Rank rank : hand_of(ranks).cards) { mask = mask | Cuarenta::to_mask(rank); }
+        return mask;
+    };
+
+    // Table 5 7: either card captures only its match, so nothing clears it.
+    Cuarenta::Table table { .cards = mask_of("57"), .last_played_card = Cuarenta::Rank::Five };
+    CHECK(Cuarenta::to_u16(Bot::limpia_ranks(table)) == 0);
+
+    // Table 2 5: a 7 (5 + 2) clears it, and so does nothing else.
+    table = Cuarenta::Table{ .cards = mask_of("25"), .last_played_card = Cuarenta::Rank::Invalid };
+    CHECK(Bot::limpia_ranks(table) == Cuarenta::to_mask(Cuarenta::Rank::Seven));
+
+    // Table 5 6: a 5 captures 5 and waterfalls the 6.
+    table = Cuarenta::Table{ .cards = mask_of("56"), .last_played_card = Cuarenta::Rank::Six };
+    CHECK(Bot::limpia_ranks(table) == Cuarenta::to_mask(Cuarenta::Rank::Five));
+
+    // Dropping a King there passes up the caida on 6 and the limpia with 5.
+    Bot::Bot bot { 1 };
+    bot.update_from_move(Cuarenta::Move{ Cuarenta::to_mask(Cuarenta::Rank::King) }, table);
+    CHECK(weight_of(bot, Cuarenta::Rank::Six)  == Bot::MISSED_CAIDA_LIKELIHOOD);
+    CHECK(weight_of(bot, Cuarenta::Rank::Five) == Bot::MISSED_LIMPIA_LIKELIHOOD);
+    CHECK(weight_of(bot, Cuarenta::Rank::King) == 1.0);
+    CHECK(bot.hand_prob[static_cast<size_t>(Cuarenta::rank_to_int(Cuarenta::Rank::King))].count == 3);
+
+    // Taking the caida with the 6 is no evidence against anything.
+    Bot::Bot taker { 1 };
+    taker.update_from_move(Cuarenta::Move{ Cuarenta::to_mask(Cuarenta::Rank::Six) }, table);
+    for (size_t i{1}; i <= Cuarenta::NUM_RANKS; i++) {
+        CHECK(taker.hand_prob[i].probability_weight == 1.0);
+    }
+
+    // A new deal drops the evidence but keeps the counts.
+    bot.update_from_hand(hand_of("A"));
+    CHECK(weight_of(bot, Cuarenta::Rank::Six) == 1.0);
+    CHECK(bot.hand_prob[static_cast<size_t>(Cuarenta::rank_to_int(Cuarenta::Rank::King))].count == 3);
+}
+
+// Probed values must equal a full minimax wherever the table applies, and
+// probing must refuse positions where a threshold is within reach.
+void test_tablebase_matches_search() {
+    const auto tablebase { Bot::Tablebase::generate(1) };
+    std::mt19937 gen { 3 };
+    int probed {};
+    int mismatches {};
+
+    for (int n{}; n < 5000; n++) {
+        Cuarenta::Search_State state{};
+        state.table.cards = Cuarenta::to_mask(static_cast<uint16_t>(gen() & Cuarenta::ALL_RANK_BITS));
+        state.players[0].hand.add(Cuarenta::int_to_rank(static_cast<int>(gen() % 10) + 1));
+        if (gen() % 2) { state.players[1].hand.add(Cuarenta::int_to_rank(static_cast<int>(gen() % 10) + 1)); }
+        if (gen() % 2) { // the last dropped card is always still on the table
+            state.table.last_played_card = Cuarenta::to_rank(Cuarenta::to_u16(state.players[0].hand.ranks()));
+            state.table.cards = state.table.cards | Cuarenta::to_mask(state.table.last_played_card);
+        }
+        state.players[0].score = static_cast<uint8_t>(gen() % 40);
+        state.players[1].score = static_cast<uint8_t>(gen() % 40);
+
+        const double searched { Bot::minimax(state, 4) };
+        if (!tablebase.probe(state, 4)) { continue; }
+        probed++;
+
+        Bot::set_active_tablebase(&tablebase);
+        const double solved { Bot::minimax(state, 4) };
+        Bot::set_active_tablebase(nullptr);
+        if (solved != searched) { mismatches++; }
+    }
+    CHECK(probed > 1000);
+    CHECK(mismatches == 0);
+
+    Cuarenta::Search_State near_forty{};
+    near_forty.table.cards = Cuarenta::to_mask(Cuarenta::Rank::Five);
+    near_forty.players[0].hand.add(Cuarenta::Rank::Five);
+    near_forty.players[0].score = 36;
+    CHECK(!tablebase.probe(near_forty, 4).has_value());
+    near_forty.players[0].score = 35;
+    CHECK(tablebase.probe(near_forty, 4) == 2); // limpia
+    CHECK(!tablebase.probe(near_forty, 0).has_value());
+}
+
+// The depth-specialised search returns minimax()'s values at every depth,
+// past the end of the deal, with a tablebase probed, and for hands that
+// take the runtime fallback.
+void test_minimax_fixed_depth() {
+    const auto tablebase { Bot::Tablebase::generate(1) };
+    int mismatches {};
+
+    for (uint32_t seed{}; seed < 40; seed++) {
+        std::mt19937 gen { seed };
+        Cuarenta::Game_State game { gen };
+        for (uint32_t ply{}; ply < seed % 10; ply++) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+            std::uniform_int_distribution<size_t> pick { 0, moves.size() - 1 };
+            Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(pick(gen)) });
+            game.advance_turn();
+        }
+        auto state { Cuarenta::to_search_state(game) };
+        for (const int depth : { 0, 1, 2, 3, 4, 5, 12 }) {
+            mismatches += Bot::minimax_fixed_depth(state, depth) != Bot::minimax(state, depth);
+        }
+        Bot::set_active_tablebase(&tablebase);
+        mismatches += Bot::minimax_fixed_depth(state, 12) != Bot::minimax(state, 12);
+        Bot::set_active_tablebase(nullptr);
+    }
+    CHECK(mismatches == 0);
+
+    // Hands no deal produces: the mover out of cards against two, and three
+    // cards against one.
+    auto empty_handed { state_with(0, Cuarenta::to_u16(Cuarenta::Rank::Four)) };
+    Cuarenta::opposing_player_state(empty_handed).hand.add(Cuarenta::Rank::Two);
+    Cuarenta::opposing_player_state(empty_handed).hand.add(Cuarenta::Rank::Six);
+    CHECK(Bot::minimax_fixed_depth(empty_handed, 3) == Bot::minimax(empty_handed, 3));
+
+    auto lopsided { state_with(Cuarenta::to_u16(Cuarenta::Rank::Two) | Cuarenta::to_u16(Cuarenta::Rank::Five) |
+                               Cuarenta::to_u16(Cuarenta::Rank::Six), Cuarenta::to_u16(Cuarenta::Rank::Four)) };
+    Cuarenta::opposing_player_state(lopsided).hand.add(Cuarenta::Rank::Ace);
+    CHECK(Bot::minimax_fixed_depth(lopsided, 5) == Bot::minimax(lopsided, 5));
+}
+
+// Move ordering only changes which subtrees alpha-beta prunes: values match
+// minimax with one worker's killers and history carried across positions,
+// and the ordered search visits fewer nodes than generator order.
+void test_move_ordering_preserves_values() {
+    constexpr double full_window { std::numeric_limits<double>::max() };
+    Bot::SearchWorker ordered{};
+    Bot::SearchWorker unordered{};
+    unordered.order_moves = false;
+    int mismatches {};
+
+    for (uint32_t seed{}; seed < 60; seed++) {
+        std::mt19937 gen { seed };
+        Cuarenta::Game_State game { gen };
+        for (uint32_t ply{}; ply < seed % 6; ply++) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+            std::uniform_int_distribution<size_t> pick { 0, moves.size() - 1 };
+            Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(pick(gen)) });
+            game.advance_turn();
+        }
+        auto state { Cuarenta::to_search_state(game) };
+        const double expected { Bot::minimax(state, 5) };
+        if (Bot::negamax(state, 5, -full_window, full_window, nullptr, &ordered) != expected) { mismatches++; }
+        if (Bot::negamax(state, 5, -full_window, full_window, nullptr, &unordered) != expected) { mismatches++; }
+    }
+    CHECK(mismatches == 0);
+    CHECK(ordered.stats.nodes < unordered.stats.nodes);
+
+    // A caida outranks a bigger capture, which outranks a drop.
+    auto state { state_with(Cuarenta::to_u16(Cuarenta::Rank::Four) | Cuarenta::to_u16(Cuarenta::Rank::Five) |
+                            Cuarenta::to_u16(Cuarenta::Rank::King),
+                            Cuarenta::to_u16(Cuarenta::Rank::Four) | Cuarenta::to_u16(Cuarenta::Rank::Five) |
+                            Cuarenta::to_u16(Cuarenta::Rank::Six)) };
+    state.table.last_played_card = Cuarenta::Rank::Four;
+    const auto caida   { Bot::MoveOrdering::static_score(state, Cuarenta::to_mask(Cuarenta::Rank::Four)) };
+    const auto capture { Bot::MoveOrdering::static_score(state, Cuarenta::to_mask(Cuarenta::Rank::Five)) };
+    const auto drop    { Bot::MoveOrdering::static_score(state, Cuarenta::to_mask(Cuarenta::Rank::King)) };
+    CHECK(caida > capture);
+    CHECK(capture > drop);
+}
+
+// Default tables reproduce the score-difference heuristic, survive a
+// save/load round trip, and never pick up a tablebase solved for a
+// different evaluator.
+void test_table_evaluator() {
+    const Bot::TableEvaluator defaults{};
+    const Bot::Evaluator& score_difference { Bot::default_evaluator() };
+    std::mt19937 gen { 5 };
+    int mismatches {};
+
+    std::vector<Cuarenta::Search_State> states;
+    for (int n{}; n < 2000; n++) {
+        Cuarenta::Search_State state{};
+        state.table.cards = Cuarenta::to_mask(static_cast<uint16_t>(gen() & Cuarenta::ALL_RANK_BITS));
+        state.players[0].num_captured_cards = static_cast<uint8_t>(gen() % 41);
+        state.players[1].num_captured_cards = static_cast<uint8_t>(gen() % (41 - state.players[0].num_captured_cards));
+        state.players[0].score = static_cast<uint8_t>(gen() % 40);
+        state.players[1].score = static_cast<uint8_t>(gen() % 40);
+        state.to_move = (gen() % 2) ? Cuarenta::Player::P1 : Cuarenta::Player::P2;
+        if (defaults.evaluate(state) != score_difference.evaluate(state)) { mismatches++; }
+        states.push_back(state);
+    }
+    CHECK(mismatches == 0);
+    CHECK(defaults.id() != score_difference.id());
+
+    Bot::TableEvaluator learned{};
+    for (size_t mask{}; mask < Bot::TableEvaluator::NUM_TABLES; mask++) {
+        learned.table()[mask] = static_cast<int32_t>(std::popcount(mask)) * 40 - 100;
+    }
+    learned.captured()[19][10] += 300;
+    learned.update_id();
+    CHECK(learned.id() != defaults.id());
+
+    const std::string path { "unit_test_eval.txt" };
+    learned.save(path);
+    const auto loaded { Bot::TableEvaluator::load(path) };
+    std::remove(path.c_str());
+    CHECK(loaded.id() == learned.id());
+    mismatches = 0;
+    for (const auto& state : states) {
+        if (loaded.evaluate(state) != learned.evaluate(state)) { mismatches++; }
+    }
+    CHECK(mismatches == 0);
+
+    const auto tablebase { Bot::Tablebase::generate(1) };
+    Cuarenta::Search_State endgame{};
+    endgame.table.cards = Cuarenta::to_mask(Cuarenta::Rank::Five);
+    endgame.players[0].hand.add(Cuarenta::Rank::Five);
+    endgame.players[1].hand.add(Cuarenta::Rank::Two);
+    const double searched { Bot::minimax(endgame, 4, learned) };
+    Bot::set_active_tablebase(&tablebase);
+    CHECK(Bot::minimax(endgame, 4, learned) == searched);
+    Bot::set_active_tablebase(nullptr);
+}
+
+// With no positions the fit returns the prior; with plenty of positions it
+// recovers an additive captured + table-size model.
+void test_eval_fit() {
+    const Bot::TableEvaluator prior{};
+    CHECK(selfplay::Eval_Fit_Data{}.fit(prior, 50.0).id() == prior.id());
+
+    selfplay::Eval_Fit_Data data{};
+    for (int repeat{}; repeat < 200; repeat++) {
+        for (int table_cards{}; table_cards <= 4; table_cards++) {
+            data.add(12, 8, table_cards, 3 + table_cards);
+            data.add(8, 12, table_cards, -1 + table_cards);
+        }
+    }
+    const auto fitted { data.fit(prior, 1.0) };
+    constexpr int32_t ONE { Bot::TableEvaluator::FIXED_POINT_ONE };
+    const auto near = [](const int32_t actual, const int32_t expected) { return std::abs(actual - expected) <= ONE / 16; };
+    // Differences are identified by the data; levels are pinned by the prior.
+    CHECK(near(fitted.captured()[12][8] - fitted.captured()[8][12], 4 * ONE));
+    CHECK(near(fitted.table()[0b111] - fitted.table()[0b1], 2 * ONE));
+    CHECK(fitted.table()[0b111] == fitted.table()[0b1110000000]);
+    CHECK(fitted.captured()[30][2] == prior.captured()[30][2]);
+}
+
+// ISMCTS runs exactly its iteration budget, is reproducible for a fixed seed
+// and thread count, and finds a caida that wins the game on the spot.
+void test_ismcts_engine() {
+    Cuarenta::Game_State game { hand_of("5QK"), hand_of("237") };
+    game.table.cards = Cuarenta::to_mask(Cuarenta::Rank::Five) | Cuarenta::to_mask(Cuarenta::Rank::Jack);
+    game.table.last_played_card = Cuarenta::Rank::Five;
+    game.players[0].score = 38;
+
+    Bot::Bot bot { 2000, Bot::SearchMode::AlphaBeta, 2 };
+    bot.engine_ = Bot::SearchEngine::Ismcts;
+    bot.seed_ = 7;
+    bot.update_from_hand(game.players[0].hand);
+
+    const auto first  { Bot::evaluate_with_ismcts(bot, game, 10, Bot::SearchBudget{}) };
+    const auto second { Bot::evaluate_with_ismcts(bot, game, 10, Bot::SearchBudget{}) };
+    CHECK(first.num_iterations == 2000);
+    CHECK(first.visits == second.visits);
+    CHECK(first.best_move.move.targets_mask == Cuarenta::to_mask(Cuarenta::Rank::Five));
+    CHECK(Bot::choose_best_move(bot, game, 10).targets_mask == Cuarenta::to_mask(Cuarenta::Rank::Five));
+}
+
+// Every unit runs exactly once however the deques get stolen from, an
+// exception surfaces in the caller, and PIMC values no longer depend on the
+// thread count.
+void test_work_stealing() {
+    util::WorkStealingScheduler scheduler { 4 };
+    std::vector<std::atomic<int>> runs(1000);
+    scheduler.run(runs.size(), [&](size_t, const size_t unit) { runs[unit]++; });
+    CHECK(std::ranges::all_of(runs, [](const std::atomic<int>& r) { return r == 1; }));
+    CHECK(scheduler.total_stats().tasks == runs.size());
+    CHECK(scheduler.stats().size() == 4);
+
+    bool threw { false };
+    try {
+        scheduler.run(10, [](size_t, const size_t unit) { if (unit == 3) { throw std::runtime_error("unit 3"); } });
+    } catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+
+    std::mt19937 gen { 11 };
+    const Cuarenta::Game_State game { gen };
+    Bot::Bot one_thread { 40, Bot::SearchMode::AlphaBeta, 1 };
+    one_thread.seed_ = 3;
+    one_thread.update_from_hand(game.players[0].hand);
+    Bot::Bot three_threads { one_thread };
+    three_threads.num_threads_ = 3;
+
+    Bot::SchedulerStats stats{};
+    const auto serial   { Bot::evaluate_all_moves(one_thread, game, 4) };
+    const auto parallel { Bot::evaluate_all_moves(three_threads, game, 4, &stats) };
+    CHECK(serial.size() == parallel.size());
+    for (size_t i{}; i < std::min(serial.size(), parallel.size()); i++) {
+        CHECK(serial[i].eval == parallel[i].eval);
+    }
+    CHECK(stats.size() == 3);
+}
+
+// A finished ponder hands over exactly the search the bot would have run
+// itself, unknown positions miss, and stop() cancels a ponder in progress.
+void test_ponderer() {
+    std::mt19937 gen { 5 };
+    const Cuarenta::Game_State game { gen };
+    Bot::Bot bot { 24, Bot::SearchMode::AlphaBeta, 1 };
+    bot.seed_ = 9;
+
+    Bot::Ponderer ponderer { bot, 4 };
+    ponderer.start(game);
+    ponderer.wait();
+
+    const auto human_moves { Cuarenta::generate_all_moves(game) };
+    Cuarenta::Game_State reply { game };
+    Cuarenta::make_move_in_place(reply, Cuarenta::Move{ human_moves.at(human_moves.size() - 1) });
+    reply.advance_turn();
+
+    auto pondered { ponderer.take(reply) };
+    CHECK(pondered != nullptr);
+    if (pondered) {
+        Bot::AnytimeSearch fresh { bot, reply, 4 };
+        fresh.run_batch(24);
+        CHECK(pondered->num_samples() == 24);
+        const auto a { pondered->evaluations() };
+        const auto b { fresh.evaluations() };
+        CHECK(a.size() == b.size());
+        for (size_t i{}; i < std::min(a.size(), b.size()); i++) { CHECK(a[i].eval == b[i].eval); }
+    }
+    CHECK(ponderer.take(game) == nullptr);
+
+    Bot::Bot slow { 100000, Bot::SearchMode::AlphaBeta, 1 };
+    Bot::Ponderer cancelled { slow, 10 };
+    cancelled.start(game);
+    cancelled.stop();
+    const auto partial { cancelled.take(reply) };
+    CHECK(!partial || partial->num_samples() < 100000);
+}
+
+// Two plies later in the same deal, a bot that kept its context gets the
+// same values as one starting cold, from fewer nodes; a new deal clears it.
+void test_search_context_reuse() {
+    std::mt19937 gen { 21 };
+    Cuarenta::Game_State game { gen };
+    Bot::Bot warm { 30, Bot::SearchMode::AlphaBeta, 1 };
+    warm.seed_ = 4;
+    warm.update_from_hand(game.players[0].hand);
+    warm.context_ = std::make_shared<Bot::SearchContext>();
+
+    auto cold_search = [&warm](const Cuarenta::Game_State& position, uint64_t& nodes) {
+        Bot::Bot cold { warm };
+        cold.context_ = std::make_shared<Bot::SearchContext>();
+        auto evals { Bot::evaluate_all_moves(cold, position, 6) };
+        nodes = cold.context_->search_stats().nodes;
+        return evals;
+    };
+
+    uint64_t cold_nodes {};
+    const auto first { Bot::evaluate_all_moves(warm, game, 6) };
+    const auto first_cold { cold_search(game, cold_nodes) };
+    CHECK(first.size() == first_cold.size());
+    for (size_t i{}; i < std::min(first.size(), first_cold.size()); i++) { CHECK(first[i].eval == first_cold[i].eval); }
+
+    for (int ply{}; ply < 2; ply++) {
+        Cuarenta::make_move_in_place(game, Cuarenta::Move{ Cuarenta::generate_all_moves(game).at(0) });
+        game.advance_turn();
+    }
+    const auto second { Bot::evaluate_all_moves(warm, game, 6) };
+    const uint64_t warm_nodes { warm.context_->search_stats().nodes };
+    const auto second_cold { cold_search(game, cold_nodes) };
+    CHECK(second.size() == second_cold.size());
+    for (size_t i{}; i < std::min(second.size(), second_cold.size()); i++) { CHECK(second[i].eval == second_cold[i].eval); }
+    CHECK(warm_nodes < cold_nodes);
+
+    warm.update_from_hand(game.players[0].hand);
+    CHECK(warm.context_->search_stats().nodes == 0);
+}
+
+// The lockstep engine reproduces scalar minimax world for world, with the
+// score-difference kernel and through the generic evaluator path.
+void test_batch_search_matches_minimax() {
+    const Bot::TableEvaluator tables{};
+    for (const Bot::Evaluator* evaluator : { &Bot::default_evaluator(), static_cast<const Bot::Evaluator*>(&tables) }) {
+        for (uint32_t seed{1}; seed <= 6; seed++) {
+            std::mt19937 gen { seed };
+            Cuarenta::Game_State game { gen };
+            for (uint32_t ply{}; ply < seed % 5; ply++) {
+                const auto moves { Cuarenta::generate_all_moves(game) };
+                Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(gen() % moves.size()) });
+                game.advance_turn();
+            }
+            const auto root { Cuarenta::to_search_state(game) };
+            const auto moves { Cuarenta::generate_all_moves(root) };
+
+            Bot::Bot dealer { 1 };
+            dealer.update_from_hand(Cuarenta::current_player_state(game).hand);
+            const Bot::HandSampler sampler { dealer.make_hand_sampler() };
+            std::vector<Cuarenta::Packed_Hand> hands;
+            for (int w{}; w < 70; w++) { hands.push_back(sampler.sample(Cuarenta::opposing_player_state(root).hand.size(), gen)); }
+
+            const int depth { 4 };
+            std::vector<double> batched(hands.size() * moves.size());
+            Bot::batch_root_values(root, hands, moves, depth, *evaluator, batched);
+
+            for (size_t w{}; w < hands.size(); w++) {
+                auto world { root };
+                Cuarenta::opposing_player_state(world).hand = hands[w];
+                for (size_t i{}; i < moves.size(); i++) {
+                    const Cuarenta::Undo undo { Cuarenta::make_move_in_place(world, Cuarenta::Move{ moves.at(i) }) };
+                    world.advance_turn();
+                    const double scalar { -Bot::minimax(world, depth - 1, *evaluator) };
+                    world.unadvance_turn();
+                    Cuarenta::undo_move_in_place(world, undo);
+                    CHECK(batched[w * moves.size() + i] == scalar);
+                }
+            }
+        }
+    }
+}
+
+// Rank-by-rank waterfall, as the rules state it; the reference for the kernels.
+int reference_waterfall(uint16_t& table, const int rank_idx) {
+    int length {};
+    for (int r { rank_idx + 1 }; r <= static_cast<int>(Cuarenta::NUM_RANKS) && ((table >> (r - 1)) & 1u); r++) {
+        table = static_cast<uint16_t>(table & ~(1u << (r - 1)));
+        length++;
+    }
+    return length;
+}
+
+// Every table (2^10) x played rank (10): the waterfall kernel against the
+// reference, then each legal move, with and without a caida, made and
+// undone on a Search_State against the rules spelled out by hand.
+void test_bit_kernels_exhaustive() {
+    int mismatches {};
+    uint64_t moves_checked {};
+
+    for (uint32_t table{}; table < (1u << Cuarenta::NUM_RANKS); table++) {
+        for (int rank_idx{1}; rank_idx <= static_cast<int>(Cuarenta::NUM_RANKS); rank_idx++) {
+            const uint16_t played { static_cast<uint16_t>(1u << (rank_idx - 1)) };
+            const uint16_t table_bits { static_cast<uint16_t>(table) };
+
+            uint16_t waterfalled { table_bits };
+            const int length { reference_waterfall(waterfalled, rank_idx) };
+            mismatches += Cuarenta::waterfall_length(table_bits, played) != length;
+            mismatches += (table_bits & ~Cuarenta::waterfall_mask(played, length)) != waterfalled;
+
+            std::vector<uint16_t> moves { played };
+            for (const Cuarenta::RankMask addition : Cuarenta::ADDITIONS_BY_RANK[rank_idx]) {
+                if ((table_bits & Cuarenta::to_u16(addition)) == Cuarenta::to_u16(addition)) {
+                    moves.push_back(static_cast<uint16_t>(played | Cuarenta::to_u16(addition)));
+                }
+            }
+
+            for (const uint16_t move : moves) {
+                for (const bool caida_setup : { false, true }) {
+                    // The last dropped card is always still on the table.
+                    if (caida_setup && !(table_bits & played)) { continue; }
+
+                    Cuarenta::Search_State state{};
+                    state.table.cards = Cuarenta::to_mask(table_bits);
+                    state.table.last_played_card = caida_setup ? Cuarenta::to_rank(played) : Cuarenta::Rank::Invalid;
+                    state.players[0].hand.add(Cuarenta::to_rank(played));
+                    state.players[0].num_captured_cards = 5;
+                    state.players[0].score = 10;
+
+                    const bool addition { move != played };
+                    const uint16_t taken { addition ? static_cast<uint16_t>(move & ~played) : played };
+                    Cuarenta::Search_State expected { state };
+                    expected.players[0].hand.remove(Cuarenta::to_rank(played));
+                    if ((table_bits & taken) != taken) {
+                        expected.table.cards = Cuarenta::to_mask(static_cast<uint16_t>(table_bits | played));
+                        expected.table.last_played_card = Cuarenta::to_rank(played);
+                    } else {
+                        uint16_t after { table_bits };
+                        const int run { reference_waterfall(after, rank_idx) };
+                        after = static_cast<uint16_t>(after & ~taken);
+                        expected.table.cards = Cuarenta::to_mask(after);
+                        expected.table.last_played_card = Cuarenta::Rank::Invalid;
+                        expected.players[0].num_captured_cards = static_cast<uint8_t>(
+                            5 + (addition ? std::popcount(move) : 2) + run);
+                        expected.players[0].score = static_cast<uint8_t>(
+                            10 + ((!addition && caida_setup) ? 2 : 0) + ((after == 0) ? 2 : 0));
+                    }
+
+                    const auto before { state };
+                    const Cuarenta::Undo undo { Cuarenta::make_move_in_place(state, Cuarenta::Move{ Cuarenta::to_mask(move) }) };
+                    mismatches += !(state == expected);
+                    Cuarenta::undo_move_in_place(state, undo);
+                    mismatches += !(state == before);
+                    moves_checked++;
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(moves_checked > 10240);
+}
+
+// try_make_move() accepts exactly what generate_all_moves() lists, leaves
+// the state alone on a rejection, and plays like the unchecked path.
+void test_try_make_move() {
+    int mismatches {};
+    uint64_t masks_checked {};
+
+    for (uint32_t seed{}; seed < 200; seed++) {
+        std::mt19937 gen { seed };
+        Cuarenta::Game_State game { gen };
+
+        while (!Cuarenta::current_player_state(game).hand.cards.empty()) {
+            const auto moves { Cuarenta::generate_all_moves(game) };
+            const auto state { Cuarenta::to_search_state(game) };
+
+            for (uint32_t mask{}; mask < (1u << Cuarenta::NUM_RANKS); mask++) {
+                const Cuarenta::Move move { Cuarenta::to_mask(static_cast<uint16_t>(mask)) };
+                const bool listed { moves.find(move.targets_mask) != moves.size() };
+
+                auto checked { state };
+                const auto undo { Cuarenta::try_make_move(checked, move) };
+                mismatches += undo.has_value() != listed;
+                if (!undo) {
+                    mismatches += !(checked == state);
+                    continue;
+                }
+                auto unchecked { state };
+                Cuarenta::make_move_unchecked(unchecked, move);
+                mismatches += !(checked == unchecked);
+                Cuarenta::undo_move_unchecked(checked, *undo);
+                mismatches += !(checked == state);
+
+                auto full { game };
+                mismatches += !Cuarenta::try_make_move(full, move).has_value();
+                mismatches += !(Cuarenta::to_search_state(full) == unchecked);
+                masks_checked++;
+            }
+
+            std::uniform_int_distribution<size_t> pick { 0, moves.size() - 1 };
+            Cuarenta::make_move_in_place(game, Cuarenta::Move{ moves.at(pick(gen)) });
+            game.advance_turn();
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(masks_checked > 1000);
+
+    // Five in hand, Ace and Two on the table.
+    Cuarenta::Game_State game{};
+    game.table.cards = Cuarenta::to_mask(Cuarenta::Rank::Ace) | Cuarenta::to_mask(Cuarenta::Rank::Two);
+    Cuarenta::current_player_state(game).hand.cards = { Cuarenta::Rank::Five };
+    const auto error_of = [&game](const uint16_t bits) {
+        auto copy { game };
+        const auto undo { Cuarenta::try_make_move(copy, Cuarenta::Move{ Cuarenta::to_mask(bits) }) };
+        return undo ? std::optional<Cuarenta::Move_Error>{} : undo.error();
+    };
+    const uint16_t ace  { Cuarenta::to_u16(Cuarenta::Rank::Ace) };
+    const uint16_t four { Cuarenta::to_u16(Cuarenta::Rank::Four) };
+    const uint16_t five { Cuarenta::to_u16(Cuarenta::Rank::Five) };
+    CHECK(error_of(0) == Cuarenta::Move_Error::Not_A_Move);
+    CHECK(error_of(1u << 12) == Cuarenta::Move_Error::Not_A_Move);
+    CHECK(error_of(Cuarenta::to_u16(Cuarenta::Rank::King)) == Cuarenta::Move_Error::Card_Not_In_Hand);
+    CHECK(error_of(five | ace) == Cuarenta::Move_Error::Not_An_Addition);
+    CHECK(error_of(five | four | ace) == Cuarenta::Move_Error::Cards_Not_On_Table);
+    CHECK(!error_of(five).has_value());
+
+    bool threw {};
+    try {
+        Cuarenta::make_move_in_place(game, Cuarenta::Move{ Cuarenta::to_mask(static_cast<uint16_t>(five | ace)) });
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(Cuarenta::current_player_state(game).hand.cards.size() == 1);
+}
+
+} // namespace
+
 int main() {
+    test_movegen_lookup_matches_reference();
+    test_perft_known_counts();
+    test_make_undo_round_trip();
+    test_bit_kernels_exhaustive();
+    test_try_make_move();
+    test_hand_sampler_respects_counts();
+    test_hand_sampler_enumeration();
+    test_inference_from_non_plays();
+    test_tablebase_matches_search();
+    test_minimax_fixed_depth();
+    test_move_ordering_preserves_values();
+    test_table_evaluator();
+    test_eval_fit();
+    test_ismcts_engine();
+    test_work_stealing();
+    test_ponderer();
+    test_search_context_reuse();
+    test_batch_search_matches_minimax();
+
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All tests passed\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,107 @@
+#include "work_stealing.h"
+
+#include "timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+namespace util {
+
+WorkStealingScheduler::WorkStealingScheduler(const size_t num_workers)
+    : stats_(std::max<size_t>(num_workers, 1)) {
+    deques_.reserve(stats_.size());
+    for (size_t i{}; i < stats_.size(); i++) { deques_.push_back(std::make_unique<Deque>()); }
+}
+
+WorkerStats WorkStealingScheduler::total_stats() const {
+    WorkerStats total{};
+    for (const WorkerStats& s : stats_) { total.merge(s); }
+    return total;
+}
+
+void WorkStealingScheduler::reset_stats() {
+    std::ranges::fill(stats_, WorkerStats{});
+}
+
+bool WorkStealingScheduler::pop(const size_t worker, size_t& unit) {
+    Deque& own { *deques_[worker] };
+    std::lock_guard lock { own.mutex };
+    if (own.begin == own.end) { return false; }
+    unit = own.begin++;
+    return true;
+}
+
+// Moves the back half of the first non-empty victim's units, starting after
+// the thief, into the thief's own (empty) deque.
+bool WorkStealingScheduler::steal(const size_t thief) {
+    const size_t n { deques_.size() };
+    for (size_t offset{1}; offset < n; offset++) {
+        Deque& victim { *deques_[(thief + offset) % n] };
+        size_t begin {};
+        size_t end {};
+        {
+            std::lock_guard lock { victim.mutex };
+            const size_t remaining { victim.end - victim.begin };
+            if (remaining == 0) { continue; }
+            end   = victim.end;
+            begin = victim.end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+        Deque& own { *deques_[thief] };
+        std::lock_guard lock { own.mutex };
+        own.begin = begin;
+        own.end   = end;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingScheduler::run(const size_t num_units, const std::function<void(size_t, size_t)>& unit,
+                                ThreadPool& pool) {
+    if (num_units == 0) { return; }
+
+    const size_t n { deques_.size() };
+    for (size_t w{}; w < n; w++) {
+        std::lock_guard lock { deques_[w]->mutex };
+        deques_[w]->begin = num_units * w / n;
+        deques_[w]->end   = num_units * (w + 1) / n;
+    }
+
+    const Timer timer{};
+    std::vector<Timer::Clock::time_point> started(n);
+    std::vector<Timer::Clock::time_point> finished(n);
+    std::atomic<bool> failed { false };
+
+    pool.parallel_for(n, [&](const size_t worker) {
+        started[worker] = Timer::Clock::now();
+        WorkerStats& stats { stats_[worker] };
+        try {
+            size_t u {};
+            while (!failed.load(std::memory_order_relaxed)) {
+                if (!pop(worker, u)) {
+                    if (!steal(worker)) { break; }
+                    stats.steals++;
+                    continue;
+                }
+                const Timer unit_timer{};
+                unit(worker, u);
+                stats.busy_s += unit_timer.elapsed_s();
+                stats.tasks++;
+            }
+        } catch (...) {
+            failed = true;
+            finished[worker] = Timer::Clock::now();
+            throw;
+        }
+        finished[worker] = Timer::Clock::now();
+    });
+
+    const auto end { Timer::Clock::now() };
+    for (size_t w{}; w < n; w++) {
+        stats_[w].idle_s += std::chrono::duration<double>((started[w] - timer.start()) + (end - finished[w])).count();
+    }
+}
+
+} // namespace util
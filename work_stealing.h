@@ -0,0 +1,68 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace util {
+
+struct WorkerStats {
+    uint64_t tasks{};  // units run
+    uint64_t steals{}; // successful steals from another worker's deque
+    double busy_s{};   // time spent inside units
+    double idle_s{};   // time in run() without a unit: waiting for a thread or for the others to finish
+
+    void merge(const WorkerStats& other) {
+        tasks  += other.tasks;
+        steals += other.steals;
+        busy_s += other.busy_s;
+        idle_s += other.idle_s;
+    }
+};
+
+// Runs a fixed set of independent units on num_workers workers. Units start
+// dealt out in contiguous blocks, one deque per worker. A worker takes from
+// the front of its own deque and, once that is empty, steals the back half
+// of another worker's. Units are fixed when run() starts, so a worker that
+// finds every deque empty is done.
+//
+// Workers run as tasks on a ThreadPool, so calling run() from inside another
+// pool task is safe; a worker that starts late mostly finds its units stolen.
+class WorkStealingScheduler {
+public:
+    explicit WorkStealingScheduler(const size_t num_workers);
+
+    // Calls unit(worker, u) for every u in [0, num_units) and blocks until all
+    // have run. After a unit throws, no new units start and the first
+    // exception is rethrown.
+    void run(const size_t num_units, const std::function<void(size_t, size_t)>& unit,
+             ThreadPool& pool = ThreadPool::shared());
+
+    size_t num_workers() const { return deques_.size(); }
+
+    // Accumulated over every run() since construction or reset_stats().
+    const std::vector<WorkerStats>& stats() const { return stats_; }
+    WorkerStats total_stats() const;
+    void reset_stats();
+
+private:
+    // [begin, end) of the units still queued on one worker.
+    struct alignas(64) Deque {
+        std::mutex mutex;
+        size_t begin{};
+        size_t end{};
+    };
+
+    bool pop(const size_t worker, size_t& unit);
+    bool steal(const size_t thief);
+
+    std::vector<std::unique_ptr<Deque>> deques_;
+    std::vector<WorkerStats> stats_;
+};
+
+} // namespace util